@@ -1,70 +1,506 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "workload.h"
 
-#define MAX_BLOCKS 100
+typedef struct {
+    int id; int size; int start_addr; int is_allocated;
+    int requested;      /* size asked for (buddy rounds it up) */
+    int prev, next;     /* neighbours in address order, -1 at either end */
+    int heap_pos;       /* worst-fit: slot in free_heap while free, -1 otherwise */
+    int link[2];        /* best-fit: treap children; buddy/segregated: free list prev/next */
+    unsigned prio;      /* best-fit: treap priority */
+} MemoryBlock;
 
-typedef struct { int id; int size; int start_addr; int is_allocated; } MemoryBlock;
-
-static MemoryBlock memory_map[MAX_BLOCKS];
-static int block_count = 0;
+/* Blocks live in a growable pool and are chained in address order, so a split
+   links the remainder in place instead of shifting the array. Each strategy
+   indexes the free blocks its own way (see strategies[] below), and ids index
+   their block directly since they only grow. */
+static MemoryBlock *memory_map;
+static int block_count = 0, block_capacity = 0;
+static int *unused_blocks;          /* pool slots released by buddy merges */
+static int unused_count = 0;
+static int first_block = -1;
+static int *free_heap;
+static int free_count = 0;
+static int *id_to_block;
+static int id_capacity = 0;
 static int next_block_id = 1;
 
-/* coalescing removed to preserve separate adjacent free segments for fragmentation metrics */
+/* coalescing is off by default to preserve separate adjacent free segments for fragmentation
+   metrics; -c immediate|deferred turns it on (the buddy allocator always merges buddies,
+   which is how it defines its blocks) */
+
+static int new_block(int size, int start_addr) {
+    int idx;
+    if (unused_count > 0) {
+        idx = unused_blocks[--unused_count];
+    } else {
+        if (block_count == block_capacity) {
+            block_capacity = block_capacity ? 2 * block_capacity : 64;
+            memory_map = realloc(memory_map, block_capacity * sizeof(MemoryBlock));
+            free_heap = realloc(free_heap, block_capacity * sizeof(int));
+            unused_blocks = realloc(unused_blocks, block_capacity * sizeof(int));
+        }
+        idx = block_count++;
+    }
+    MemoryBlock *b = &memory_map[idx];
+    b->id = 0; b->size = size; b->start_addr = start_addr; b->is_allocated = 0;
+    b->requested = 0;
+    b->prev = b->next = b->heap_pos = -1;
+    b->link[0] = b->link[1] = -1;
+    b->prio = (unsigned)rand();
+    return idx;
+}
+
+/* Cut 'size' off the front of block idx; the remainder becomes a new block after it */
+static int split_block(int idx, int size) {
+    int rest = new_block(memory_map[idx].size - size, memory_map[idx].start_addr + size);
+    memory_map[rest].prev = idx;
+    memory_map[rest].next = memory_map[idx].next;
+    if (memory_map[idx].next != -1) memory_map[memory_map[idx].next].prev = rest;
+    memory_map[idx].next = rest;
+    memory_map[idx].size = size;
+    return rest;
+}
+
+static int rover = -1;              /* next fit: block of the previous allocation */
+
+/* Fold block idx's successor into it and release the successor's pool slot */
+static void absorb_next(int idx) {
+    int nx = memory_map[idx].next;
+    if (rover == nx) rover = idx;
+    memory_map[idx].size += memory_map[nx].size;
+    memory_map[idx].next = memory_map[nx].next;
+    if (memory_map[nx].next != -1) memory_map[memory_map[nx].next].prev = idx;
+    unused_blocks[unused_count++] = nx;
+}
+
+/* --- Worst fit: max-heap by size, ties to the lower address --- */
+static int heap_before(int a, int b) {
+    if (memory_map[a].size != memory_map[b].size) return memory_map[a].size > memory_map[b].size;
+    return memory_map[a].start_addr < memory_map[b].start_addr;
+}
+
+static void heap_set(int pos, int idx) {
+    free_heap[pos] = idx;
+    memory_map[idx].heap_pos = pos;
+}
+
+static void heap_sift(int pos) {
+    int idx = free_heap[pos];
+    while (pos > 0 && heap_before(idx, free_heap[(pos - 1) / 2])) {
+        heap_set(pos, free_heap[(pos - 1) / 2]);
+        pos = (pos - 1) / 2;
+    }
+    for (;;) {
+        int child = 2 * pos + 1;
+        if (child >= free_count) break;
+        if (child + 1 < free_count && heap_before(free_heap[child + 1], free_heap[child])) child++;
+        if (!heap_before(free_heap[child], idx)) break;
+        heap_set(pos, free_heap[child]);
+        pos = child;
+    }
+    heap_set(pos, idx);
+}
+
+static void heap_push(int idx) {
+    heap_set(free_count++, idx);
+    heap_sift(free_count - 1);
+}
+
+static void heap_remove(int idx) {
+    int pos = memory_map[idx].heap_pos;
+    memory_map[idx].heap_pos = -1;
+    if (--free_count == pos) return;
+    heap_set(pos, free_heap[free_count]);
+    heap_sift(pos);
+}
 
-static int allocate_worst_fit(int size) {
-    int idx = -1;
-    int best_size = -1;
-    for (int i = 0; i < block_count; i++) {
+static int worst_find(int size) {
+    if (free_count == 0 || memory_map[free_heap[0]].size < size) return -1;
+    return free_heap[0];
+}
+
+/* --- First fit / next fit: walk the address chain --- */
+
+static int first_find(int size) {
+    for (int i = first_block; i != -1; i = memory_map[i].next) {
+        if (!memory_map[i].is_allocated && memory_map[i].size >= size) return i;
+    }
+    return -1;
+}
+
+static int next_find(int size) {
+    /* Resume right after the previous allocation (its split remainder, if any) */
+    int start = (rover != -1 && memory_map[rover].next != -1) ? memory_map[rover].next : first_block;
+    int i = start;
+    do {
         if (!memory_map[i].is_allocated && memory_map[i].size >= size) {
-            if (memory_map[i].size > best_size) {
-                best_size = memory_map[i].size;
-                idx = i;
-            }
+            rover = i;
+            return i;
+        }
+        i = memory_map[i].next != -1 ? memory_map[i].next : first_block;
+    } while (i != start);
+    return -1;
+}
+
+static void no_index(int idx) { (void)idx; }
+
+/* --- Best fit: treap ordered by (size, address), lower-bound search --- */
+static int treap_root = -1;
+
+static int treap_less(int a, int b) {
+    if (memory_map[a].size != memory_map[b].size) return memory_map[a].size < memory_map[b].size;
+    return memory_map[a].start_addr < memory_map[b].start_addr;
+}
+
+static int treap_insert(int root, int idx) {
+    if (root == -1) return idx;
+    int dir = treap_less(root, idx);
+    int *child = &memory_map[root].link[dir];
+    *child = treap_insert(*child, idx);
+    if (memory_map[*child].prio > memory_map[root].prio) {
+        int c = *child;
+        *child = memory_map[c].link[!dir];
+        memory_map[c].link[!dir] = root;
+        return c;
+    }
+    return root;
+}
+
+static int treap_erase(int root, int idx) {
+    if (root == idx) {
+        int l = memory_map[root].link[0], r = memory_map[root].link[1];
+        if (l == -1) return r;
+        if (r == -1) return l;
+        int dir = memory_map[l].prio > memory_map[r].prio ? 0 : 1;
+        int c = memory_map[root].link[dir];
+        memory_map[root].link[dir] = memory_map[c].link[!dir];
+        memory_map[c].link[!dir] = treap_erase(root, idx);
+        return c;
+    }
+    int dir = treap_less(root, idx);
+    memory_map[root].link[dir] = treap_erase(memory_map[root].link[dir], idx);
+    return root;
+}
+
+static void best_add(int idx) {
+    memory_map[idx].link[0] = memory_map[idx].link[1] = -1;
+    treap_root = treap_insert(treap_root, idx);
+}
+
+static void best_del(int idx) {
+    treap_root = treap_erase(treap_root, idx);
+}
+
+static int best_find(int size) {
+    int found = -1;
+    for (int i = treap_root; i != -1; ) {
+        if (memory_map[i].size >= size) {
+            found = i;
+            i = memory_map[i].link[0];
+        } else {
+            i = memory_map[i].link[1];
         }
     }
+    return found;
+}
+
+/* --- Free lists by size class (buddy: exact order, segregated: [2^k, 2^(k+1))) --- */
+#define NUM_CLASSES 32
+static int class_head[NUM_CLASSES];
+
+static int size_class(int size) {
+    int k = 0;
+    while ((2L << k) <= size) k++;
+    return k;
+}
+
+static void list_add(int idx) {
+    int k = size_class(memory_map[idx].size);
+    memory_map[idx].link[0] = -1;
+    memory_map[idx].link[1] = class_head[k];
+    if (class_head[k] != -1) memory_map[class_head[k]].link[0] = idx;
+    class_head[k] = idx;
+}
+
+static void list_del(int idx) {
+    int p = memory_map[idx].link[0], n = memory_map[idx].link[1];
+    if (p != -1) memory_map[p].link[1] = n; else class_head[size_class(memory_map[idx].size)] = n;
+    if (n != -1) memory_map[n].link[0] = p;
+}
+
+/* Segregated fit: first fitting block of the request's own class, else any block of a larger class */
+static int segregated_find(int size) {
+    int k = size_class(size);
+    for (int i = class_head[k]; i != -1; i = memory_map[i].link[1]) {
+        if (memory_map[i].size >= size) return i;
+    }
+    for (k++; k < NUM_CLASSES; k++) {
+        if (class_head[k] != -1) return class_head[k];
+    }
+    return -1;
+}
+
+/* Buddy: every block is a power of two; take the smallest order that fits */
+static int buddy_find(int size) {
+    for (int k = size_class(size); k < NUM_CLASSES; k++) {
+        if (class_head[k] != -1) return class_head[k];
+    }
+    return -1;
+}
+
+static int buddy_round(int size) {
+    int s = 1;
+    while (s < size) s <<= 1;
+    return s;
+}
+
+/* --- Strategy switch --- */
+typedef struct {
+    const char *name;
+    int (*find)(int size);   /* free block to carve the request from, -1 if none fits */
+    void (*add)(int idx);    /* index a block that became free */
+    void (*del)(int idx);    /* unindex a free block that is being taken */
+    int buddy;               /* power-of-two blocks, split in halves, buddies merge on free */
+} Strategy;
+
+static const Strategy strategies[] = {
+    {"worst", worst_find, heap_push, heap_remove, 0},
+    {"first", first_find, no_index, no_index, 0},
+    {"next", next_find, no_index, no_index, 0},
+    {"best", best_find, best_add, best_del, 0},
+    {"buddy", buddy_find, list_add, list_del, 1},
+    {"segregated", segregated_find, list_add, list_del, 0},
+};
+#define NUM_STRATEGIES (int)(sizeof(strategies) / sizeof(strategies[0]))
+
+static const Strategy *strategy = &strategies[0];
+
+/* Allocation latency */
+static long alloc_calls = 0, alloc_failures = 0;
+static double alloc_ns_total = 0, alloc_ns_max = 0;
+
+/* Coalescing and compaction */
+enum { COALESCE_NONE, COALESCE_IMMEDIATE, COALESCE_DEFERRED };
+static int coalesce_mode = COALESCE_NONE;
+static int coalesce_batch = 64;     /* deferred: frees between sweeps */
+static int pending_frees = 0;
+static int auto_compact = 0;        /* compact and retry when an allocation fails */
+static long merges = 0, sweeps = 0, compactions = 0, bytes_moved = 0;
+static long total_free_kb = 0;
+
+static void free_stats(long *total, int *largest, long *internal) {
+    *total = 0; *largest = 0; *internal = 0;
+    for (int i = first_block; i != -1; i = memory_map[i].next) {
+        if (!memory_map[i].is_allocated) {
+            *total += memory_map[i].size;
+            if (memory_map[i].size > *largest) *largest = memory_map[i].size;
+        } else {
+            *internal += memory_map[i].size - memory_map[i].requested;
+        }
+    }
+}
+
+/* Merge free block idx with free neighbours on both sides; returns the merged block (unindexed) */
+static int coalesce(int idx) {
+    int p = memory_map[idx].prev;
+    if (p != -1 && !memory_map[p].is_allocated) {
+        strategy->del(p);
+        absorb_next(p);
+        idx = p;
+        merges++;
+    }
+    int n = memory_map[idx].next;
+    if (n != -1 && !memory_map[n].is_allocated) {
+        strategy->del(n);
+        absorb_next(idx);
+        merges++;
+    }
+    return idx;
+}
+
+/* Deferred coalescing: one pass over the address chain merging every run of free blocks */
+static void coalesce_sweep(void) {
+    for (int i = first_block; i != -1; i = memory_map[i].next) {
+        if (memory_map[i].is_allocated) continue;
+        int n = memory_map[i].next;
+        if (n == -1 || memory_map[n].is_allocated) continue;
+        strategy->del(i);
+        while (n != -1 && !memory_map[n].is_allocated) {
+            strategy->del(n);
+            absorb_next(i);
+            merges++;
+            n = memory_map[i].next;
+        }
+        strategy->add(i);
+    }
+    pending_frees = 0;
+    sweeps++;
+}
+
+/* Slide every allocated block down to address 0 in address order, leaving one free block at the top */
+static void compact(void) {
+    if (strategy->buddy) return; /* would break buddy alignment */
+    int addr = 0, last = -1;
+    for (int i = first_block, nx; i != -1; i = nx) {
+        nx = memory_map[i].next;
+        if (!memory_map[i].is_allocated) {
+            strategy->del(i);
+            unused_blocks[unused_count++] = i;
+            continue;
+        }
+        if (memory_map[i].start_addr != addr) bytes_moved += memory_map[i].size;
+        memory_map[i].start_addr = addr;
+        memory_map[i].prev = last;
+        if (last != -1) memory_map[last].next = i; else first_block = i;
+        addr += memory_map[i].size;
+        last = i;
+    }
+    if (last != -1) memory_map[last].next = -1; else first_block = -1;
+    if (total_free_kb > 0) {
+        int idx = new_block((int)total_free_kb, addr);
+        memory_map[idx].prev = last;
+        if (last != -1) memory_map[last].next = idx; else first_block = idx;
+        strategy->add(idx);
+    }
+    rover = -1;
+    pending_frees = 0;
+    compactions++;
+}
+
+static void set_owner(int id, int idx) {
+    if (id >= id_capacity) {
+        int cap = id_capacity ? id_capacity : 64;
+        while (cap <= id) cap *= 2;
+        id_to_block = realloc(id_to_block, cap * sizeof(int));
+        for (int i = id_capacity; i < cap; i++) id_to_block[i] = -1;
+        id_capacity = cap;
+    }
+    id_to_block[id] = idx;
+}
+
+static int allocate_block(int size) {
+    if (size <= 0) return -1;
+    int want = strategy->buddy ? buddy_round(size) : size;
+    int idx = strategy->find(want);
     if (idx == -1) return -1;
-    if (memory_map[idx].size == size) {
-        memory_map[idx].is_allocated = 1;
-        memory_map[idx].id = next_block_id++;
-        return memory_map[idx].id;
+    strategy->del(idx);
+    while (memory_map[idx].size > want) {
+        int cut = strategy->buddy ? memory_map[idx].size / 2 : want;
+        strategy->add(split_block(idx, cut));
     }
-    int orig_size = memory_map[idx].size;
-    int orig_start = memory_map[idx].start_addr;
-    memory_map[idx].size = size;
     memory_map[idx].is_allocated = 1;
+    memory_map[idx].requested = size;
+    total_free_kb -= memory_map[idx].size;
     memory_map[idx].id = next_block_id++;
-    if (block_count < MAX_BLOCKS) {
-        for (int j = block_count; j > idx + 1; j--) memory_map[j] = memory_map[j-1];
-        memory_map[idx + 1].id = 0;
-        memory_map[idx + 1].size = orig_size - size;
-        memory_map[idx + 1].start_addr = orig_start + size;
-        memory_map[idx + 1].is_allocated = 0;
-        block_count++;
-    }
+    set_owner(memory_map[idx].id, idx);
     return memory_map[idx].id;
 }
 
+static int allocate(int size) {
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    int id = allocate_block(size);
+    if (id == -1 && coalesce_mode == COALESCE_DEFERRED && pending_frees > 0) {
+        coalesce_sweep();
+        id = allocate_block(size);
+    }
+    if (id == -1 && auto_compact && size <= total_free_kb && !strategy->buddy) {
+        compact();
+        id = allocate_block(size);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double ns = (t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec);
+    alloc_calls++;
+    if (id == -1) alloc_failures++;
+    alloc_ns_total += ns;
+    if (ns > alloc_ns_max) alloc_ns_max = ns;
+    return id;
+}
+
+/* Merge a freed buddy block with its buddy (same size at start_addr ^ size) while it is free and whole */
+static int buddy_merge(int idx) {
+    for (;;) {
+        int size = memory_map[idx].size;
+        int upper = memory_map[idx].start_addr & size;
+        int other = upper ? memory_map[idx].prev : memory_map[idx].next;
+        if (other == -1 || memory_map[other].is_allocated || memory_map[other].size != size ||
+            memory_map[other].start_addr != (memory_map[idx].start_addr ^ size)) return idx;
+        list_del(other);
+        if (upper) idx = other;
+        absorb_next(idx);
+    }
+}
+
 static int deallocate(int id) {
-    for (int i = 0; i < block_count; i++) {
-        if (memory_map[i].is_allocated && memory_map[i].id == id) {
-            memory_map[i].is_allocated = 0;
-            memory_map[i].id = 0;
-            /* Increment ID counter to mimic example numbering (skip an ID on deallocation) */
-            next_block_id++;
-            return 1;
-        }
+    int idx = (id > 0 && id < id_capacity) ? id_to_block[id] : -1;
+    if (idx == -1) return 0;
+    id_to_block[id] = -1;
+    memory_map[idx].is_allocated = 0;
+    memory_map[idx].id = 0;
+    memory_map[idx].requested = 0;
+    total_free_kb += memory_map[idx].size;
+    if (strategy->buddy) {
+        idx = buddy_merge(idx);
+    } else if (coalesce_mode == COALESCE_IMMEDIATE) {
+        idx = coalesce(idx);
+    }
+    strategy->add(idx);
+    if (coalesce_mode == COALESCE_DEFERRED && !strategy->buddy && ++pending_frees >= coalesce_batch) {
+        coalesce_sweep();
+    }
+    /* Increment ID counter to mimic example numbering (skip an ID on deallocation) */
+    next_block_id++;
+    return 1;
+}
+
+/* Fresh memory of total_memory_size KB (buddy: power-of-two chunks, each aligned to its size) */
+static void reset_memory(int total_memory_size) {
+    block_count = unused_count = free_count = 0;
+    first_block = -1;
+    rover = -1;
+    treap_root = -1;
+    for (int k = 0; k < NUM_CLASSES; k++) class_head[k] = -1;
+    for (int i = 0; i < id_capacity; i++) id_to_block[i] = -1;
+    next_block_id = 1;
+    alloc_calls = alloc_failures = 0;
+    alloc_ns_total = alloc_ns_max = 0;
+    merges = sweeps = compactions = bytes_moved = 0;
+    pending_frees = 0;
+    total_free_kb = total_memory_size;
+    srand(1);
+
+    int addr = 0, last = -1;
+    while (addr < total_memory_size) {
+        int chunk = total_memory_size - addr;
+        if (strategy->buddy) chunk = 1 << size_class(chunk);
+        int idx = new_block(chunk, addr);
+        memory_map[idx].prev = last;
+        if (last != -1) memory_map[last].next = idx; else first_block = idx;
+        strategy->add(idx);
+        last = idx;
+        addr += chunk;
     }
-    return 0;
 }
 
 static void summarize(void) {
     int total_free = 0;
     int largest_free = 0;
-    for (int i = 0; i < block_count; i++) {
+    long internal = 0;
+    for (int i = first_block; i != -1; i = memory_map[i].next) {
         if (!memory_map[i].is_allocated) {
             total_free += memory_map[i].size;
             if (memory_map[i].size > largest_free) largest_free = memory_map[i].size;
+        } else {
+            internal += memory_map[i].size - memory_map[i].requested;
         }
     }
     int external = total_free - largest_free;
@@ -72,7 +508,7 @@ static void summarize(void) {
 
     printf("Allocated blocks: ");
     int first = 1;
-    for (int i = 0; i < block_count; i++) {
+    for (int i = first_block; i != -1; i = memory_map[i].next) {
         if (memory_map[i].is_allocated) {
             if (!first) printf(", ");
             printf("[%d] = %d KB", memory_map[i].id, memory_map[i].size);
@@ -84,7 +520,7 @@ static void summarize(void) {
 
     printf("Free segments: ");
     first = 1;
-    for (int i = 0; i < block_count; i++) {
+    for (int i = first_block; i != -1; i = memory_map[i].next) {
         if (!memory_map[i].is_allocated) {
             if (!first) printf(" + ");
             printf("%d KB", memory_map[i].size);
@@ -95,41 +531,375 @@ static void summarize(void) {
     printf("Largest contiguous free block: %d KB\n", largest_free);
     printf("External fragmentation: %d KB\n", external);
     printf("Fragmentation ratio: %.1f\n", ratio);
+    if (internal > 0) printf("Internal fragmentation (rounding): %ld KB\n", internal);
 }
 
-int main(void) {
-    int total_memory_size = 0;
-    int num_operations = 0;
-    if (printf("Enter total memory size (KB): ") && scanf("%d", &total_memory_size) != 1) return 1;
-    if (printf("Enter number of operations: ") && scanf("%d", &num_operations) != 1) return 1;
-    if (total_memory_size <= 0 || num_operations < 0) return 1;
-
-    memory_map[0].id = 0;
-    memory_map[0].size = total_memory_size;
-    memory_map[0].start_addr = 0;
-    memory_map[0].is_allocated = 0;
-    block_count = 1;
-
-    char line[128];
-    fgets(line, sizeof(line), stdin);
-    for (int i = 0; i < num_operations; i++) {
-        if (!fgets(line, sizeof(line), stdin)) break;
-        int val = 0;
-        if (sscanf(line, "Operation %*d: Allocate %d", &val) == 1) {
-            allocate_worst_fit(val);
-        } else if (sscanf(line, "Operation %*d: Deallocate block %d", &val) == 1) {
-            deallocate(val);
-        } else if (sscanf(line, "Allocate %d", &val) == 1) {
-            allocate_worst_fit(val);
-        } else if (sscanf(line, "Deallocate %d", &val) == 1) {
-            deallocate(val);
-        } else if (sscanf(line, "Deallocate block %d", &val) == 1) {
-            deallocate(val);
+static void print_latency(void) {
+    printf("Allocation latency (%s fit): %.0f ns average, %.0f ns max over %ld allocations (%ld failed)\n",
+           strategy->name, alloc_calls ? alloc_ns_total / alloc_calls : 0.0, alloc_ns_max,
+           alloc_calls, alloc_failures);
+}
+
+static void print_reclaim(void) {
+    if (coalesce_mode != COALESCE_NONE) {
+        printf("Coalescing (%s): %ld merges", coalesce_mode == COALESCE_IMMEDIATE ? "immediate" : "deferred", merges);
+        if (coalesce_mode == COALESCE_DEFERRED) printf(" in %ld sweeps", sweeps);
+        printf("\n");
+    }
+    if (compactions > 0) printf("Compaction: %ld passes, %ld KB moved\n", compactions, bytes_moved);
+}
+
+/* --- Operation log ---
+   Text: "<memory KB> <operations>", then one operation per line:
+     [Operation N:] Allocate <KB>  |  [Operation N:] Deallocate [block] <id>  |  Compact
+   Binary (-o converts any log): OpLogHeader, then one uint32 per operation with
+   the kind in the top two bits and the size or id below. */
+enum { OP_DEALLOCATE, OP_ALLOCATE, OP_COMPACT };
+typedef uint32_t Operation;
+#define OP_KIND(op) ((op) >> 30)
+#define OP_VAL_MAX 0x3fffffff   /* Largest size or id an operation can carry */
+#define OP_VAL(op) ((int)((op) & OP_VAL_MAX))
+#define MAKE_OP(kind, val) ((uint32_t)(kind) << 30 | ((uint32_t)(val) & OP_VAL_MAX))
+
+#define OPLOG_MAGIC "FRAGOPS1"
+typedef struct {
+    char magic[8];
+    uint32_t memory_kb;
+    uint32_t reserved;
+    uint64_t count;
+} OpLogHeader;
+
+typedef struct {
+    int memory_kb;
+    int count;
+    const Operation *ops;       /* into the binary mapping, or 'owned' */
+    Operation *owned;
+    void *map;
+    size_t map_size;
+    long malformed;             /* text lines that were not an operation */
+} OpLog;
+
+static const char *skip_blanks(const char *p, const char *end) {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) p++;
+    return p;
+}
+
+/* Decimal in [0, OP_VAL_MAX]; NULL if malformed or out of range */
+static const char *parse_number(const char *p, const char *end, long *v) {
+    p = skip_blanks(p, end);
+    if (p == end || *p < '0' || *p > '9') return NULL;
+    long n = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        n = n * 10 + (*p++ - '0');
+        if (n > OP_VAL_MAX) return NULL;
+    }
+    *v = n;
+    return p;
+}
+
+static int keyword(const char **p, const char *end, const char *word) {
+    size_t n = strlen(word);
+    if ((size_t)(end - *p) < n || memcmp(*p, word, n) != 0) return 0;
+    *p += n;
+    return 1;
+}
+
+/* One text line [p, end): 1 = operation stored, 0 = blank, -1 = malformed */
+static int parse_op_line(const char *p, const char *end, Operation *op) {
+    long v;
+    p = skip_blanks(p, end);
+    if (p == end) return 0;
+    if (keyword(&p, end, "Operation")) {
+        while (p < end && *p != ':') p++;
+        if (p == end) return -1;
+        p = skip_blanks(p + 1, end);
+    }
+    if (keyword(&p, end, "Allocate")) {
+        if ((p = parse_number(p, end, &v)) == NULL) return -1;
+        *op = MAKE_OP(OP_ALLOCATE, v);
+    } else if (keyword(&p, end, "Deallocate")) {
+        p = skip_blanks(p, end);
+        keyword(&p, end, "block");
+        if ((p = parse_number(p, end, &v)) == NULL) return -1;
+        *op = MAKE_OP(OP_DEALLOCATE, v);
+    } else if (keyword(&p, end, "Compact")) {
+        *op = MAKE_OP(OP_COMPACT, 0);
+    } else {
+        return -1;
+    }
+    return 1;
+}
+
+/* Parse up to log->count operations from a text buffer (after the header) */
+static void parse_ops_text(OpLog *log, const char *p, const char *end) {
+    log->owned = malloc(((size_t)log->count + 1) * sizeof(Operation));
+    int n = 0;
+    while (p < end && n < log->count) {
+        const char *eol = memchr(p, '\n', end - p);
+        if (eol == NULL) eol = end;
+        int r = parse_op_line(p, eol, &log->owned[n]);
+        if (r == 1) n++;
+        else if (r == -1) log->malformed++;
+        p = eol + 1;
+    }
+    log->count = n;
+    log->ops = log->owned;
+}
+
+static void free_oplog(OpLog *log) {
+    if (log->map) munmap(log->map, log->map_size);
+    free(log->owned);
+    log->map = NULL;
+    log->owned = NULL;
+}
+
+/* Map an op-log file (binary or text); returns -1 with a message on failure */
+static int load_oplog_file(OpLog *log, const char *path) {
+    memset(log, 0, sizeof(*log));
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) { perror(path); return -1; }
+    struct stat st;
+    if (fstat(fd, &st) == -1 || st.st_size == 0) {
+        fprintf(stderr, "%s: empty or unreadable operation log\n", path);
+        close(fd);
+        return -1;
+    }
+    log->map_size = st.st_size;
+    log->map = mmap(NULL, log->map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (log->map == MAP_FAILED) { perror("mmap operation log"); log->map = NULL; return -1; }
+    madvise(log->map, log->map_size, MADV_SEQUENTIAL);
+
+    const char *p = log->map, *end = p + log->map_size;
+    const OpLogHeader *h = log->map;
+    if (log->map_size >= sizeof(OpLogHeader) && memcmp(h->magic, OPLOG_MAGIC, 8) == 0) {
+        if (h->count > (uint64_t)INT32_MAX ||
+            sizeof(OpLogHeader) + h->count * sizeof(Operation) > log->map_size) {
+            fprintf(stderr, "%s: truncated binary operation log\n", path);
+            free_oplog(log);
+            return -1;
+        }
+        log->memory_kb = (int)h->memory_kb;
+        log->count = (int)h->count;
+        log->ops = (const Operation *)(p + sizeof(OpLogHeader));
+        return 0;
+    }
+
+    long mem, count;
+    while (p < end && (*p == '\n' || *p == ' ' || *p == '\t' || *p == '\r')) p++;
+    if ((p = parse_number(p, end, &mem)) != NULL) {
+        while (p < end && (*p == '\n' || *p == ' ' || *p == '\t' || *p == '\r')) p++;
+        p = parse_number(p, end, &count);
+    }
+    if (p == NULL) {
+        fprintf(stderr, "%s: malformed operation log header\n", path);
+        free_oplog(log);
+        return -1;
+    }
+    log->memory_kb = (int)mem;
+    log->count = (int)count;
+    if (log->count > end - p) log->count = (int)(end - p); /* Every operation takes at least a byte */
+    parse_ops_text(log, p, end);
+    return 0;
+}
+
+/* Interactive / piped input: prompts, then one line at a time until the declared count */
+static int load_oplog_stdin(OpLog *log) {
+    memset(log, 0, sizeof(*log));
+    if (printf("Enter total memory size (KB): ") && scanf("%d", &log->memory_kb) != 1) return -1;
+    if (printf("Enter number of operations: ") && scanf("%d", &log->count) != 1) return -1;
+    if (log->count < 0) return -1;
+    /* Grown as lines arrive: the declared count alone does not size the array */
+    int n = 0, capacity = 0;
+    char line[4096];
+    fgets(line, sizeof(line), stdin); /* rest of the header line */
+    while (n < log->count && fgets(line, sizeof(line), stdin)) {
+        if (n == capacity) {
+            capacity = capacity ? 2 * capacity : 1024;
+            log->owned = realloc(log->owned, (size_t)capacity * sizeof(Operation));
+        }
+        int r = parse_op_line(line, line + strcspn(line, "\n"), &log->owned[n]);
+        if (r == 1) n++;
+        else if (r == -1) log->malformed++;
+    }
+    log->count = n;
+    log->ops = log->owned;
+    return 0;
+}
+
+static int write_oplog_binary(const OpLog *log, const char *path) {
+    FILE *f = fopen(path, "wb");
+    if (f == NULL) { perror(path); return -1; }
+    OpLogHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, OPLOG_MAGIC, 8);
+    h.memory_kb = (uint32_t)log->memory_kb;
+    h.count = (uint64_t)log->count;
+    fwrite(&h, sizeof(h), 1, f);
+    fwrite(log->ops, sizeof(Operation), log->count, f);
+    return fclose(f) == 0 ? 0 : -1;
+}
+
+static int snapshot_every = 0;      /* print fragmentation every N operations (0 = off) */
+
+static void snapshot(int op) {
+    long total, internal;
+    int largest;
+    free_stats(&total, &largest, &internal);
+    printf("[op %d] free %ld KB, largest %d KB, external %ld KB, ratio %.2f, blocks %d\n", op, total, largest,
+           total - largest, total ? (double)(total - largest) / total : 0.0, block_count - unused_count);
+}
+
+static void replay(const Operation *ops, int count) {
+    for (int i = 0; i < count; i++) {
+        if (OP_KIND(ops[i]) == OP_ALLOCATE) {
+            allocate(OP_VAL(ops[i]));
+        } else if (OP_KIND(ops[i]) == OP_COMPACT) {
+            compact();
+        } else {
+            deallocate(OP_VAL(ops[i]));
+        }
+        if (snapshot_every > 0 && (i + 1) % snapshot_every == 0) snapshot(i + 1);
+    }
+}
+
+/* Benchmark: a fixed-seed churn of allocations (1-64 KB) and frees of live blocks, in
+   memory large enough that nothing fails, so every strategy sees the same block ids */
+#define BENCH_MEMORY_KB (1 << 24)
+#define BENCH_RUNS 3
+
+static void bench_strategies(int count) {
+    Operation *ops = malloc(count * sizeof(Operation));
+    int *live = malloc(count * sizeof(int));
+    int live_count = 0, id = 1;
+    Rng rng;
+    rng_seed(&rng, 1, 0);
+    for (int i = 0; i < count; i++) {
+        if (live_count > 0 && rng_below(&rng, 100) < 45) {
+            int k = (int)rng_below(&rng, live_count);
+            ops[i] = MAKE_OP(OP_DEALLOCATE, live[k]);
+            live[k] = live[--live_count];
         } else {
-            i--;
+            ops[i] = MAKE_OP(OP_ALLOCATE, rng_below(&rng, 64) + 1);
+            live[live_count++] = id;
+        }
+        id++;                        /* allocations and frees both consume an id */
+    }
+    free(live);
+
+    printf("suite,case,size,metric,value\n");
+    for (int s = 0; s < NUM_STRATEGIES; s++) {
+        strategy = &strategies[s];
+        double best = 0;
+        for (int r = 0; r < BENCH_RUNS; r++) {
+            reset_memory(BENCH_MEMORY_KB);
+            struct timespec t0, t1;
+            clock_gettime(CLOCK_MONOTONIC, &t0);
+            replay(ops, count);
+            clock_gettime(CLOCK_MONOTONIC, &t1);
+            double elapsed = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+            if (r == 0 || elapsed < best) best = elapsed;
+        }
+        printf("fragmentation,%s,%d,ops_per_sec,%.0f\n", strategy->name, count, best > 0 ? count / best : 0.0);
+        printf("fragmentation,%s,%d,failed_allocs,%ld\n", strategy->name, count, alloc_failures);
+    }
+    free(ops);
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-s worst|first|next|best|buddy|segregated|all] [-l] [-c none|immediate|deferred]\n"
+                    "          [-b frees] [-k] [-p ops] [-i oplog] [-o out.bin] [-B ops]\n"
+                    "  -s  placement strategy (default worst); all = every strategy on the same operations\n"
+                    "  -l  report allocation latency\n"
+                    "  -c  coalesce free neighbours on every free, or in batched sweeps (default none)\n"
+                    "  -b  deferred coalescing: frees between sweeps (default 64; a failed allocation also sweeps)\n"
+                    "  -k  compact memory and retry when an allocation fails but enough is free\n"
+                    "      (a 'Compact' operation line compacts on demand)\n"
+                    "  -p  print a fragmentation snapshot every N operations\n"
+                    "  -i  read operations from a text or binary log file instead of stdin\n"
+                    "  -o  convert the operations to the binary log format and exit\n"
+                    "  -B  benchmark every strategy on N generated operations (honours -c, -b, -k), CSV output\n", prog);
+    exit(1);
+}
+
+int main(int argc, char *argv[]) {
+    const char *strategy_name = "worst";
+    const char *log_path = NULL, *convert_path = NULL;
+    int show_latency = 0, bench_ops = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "s:lc:b:kp:i:o:B:")) != -1) {
+        switch (opt) {
+        case 'i': log_path = optarg; break;
+        case 'o': convert_path = optarg; break;
+        case 's': strategy_name = optarg; break;
+        case 'l': show_latency = 1; break;
+        case 'c':
+            if (strcmp(optarg, "immediate") == 0) coalesce_mode = COALESCE_IMMEDIATE;
+            else if (strcmp(optarg, "deferred") == 0) coalesce_mode = COALESCE_DEFERRED;
+            else if (strcmp(optarg, "none") != 0) usage(argv[0]);
+            break;
+        case 'b': coalesce_batch = atoi(optarg); break;
+        case 'k': auto_compact = 1; break;
+        case 'p': snapshot_every = atoi(optarg); break;
+        case 'B': bench_ops = atoi(optarg); break;
+        default: usage(argv[0]);
+        }
+    }
+    if (coalesce_batch < 1) coalesce_batch = 1;
+    if (bench_ops > 0) {
+        bench_strategies(bench_ops);
+        return 0;
+    }
+    int compare_all = strcmp(strategy_name, "all") == 0;
+    if (!compare_all) {
+        strategy = NULL;
+        for (int s = 0; s < NUM_STRATEGIES; s++) {
+            if (strcmp(strategies[s].name, strategy_name) == 0) strategy = &strategies[s];
         }
+        if (strategy == NULL) usage(argv[0]);
     }
 
-    summarize();
+    /* Read every operation first so each strategy replays the same workload */
+    OpLog log;
+    if ((log_path ? load_oplog_file(&log, log_path) : load_oplog_stdin(&log)) == -1) return 1;
+    int total_memory_size = log.memory_kb;
+    if (total_memory_size <= 0) return 1;
+    if (log.malformed > 0) fprintf(stderr, "Skipped %ld malformed operation lines\n", log.malformed);
+    const Operation *ops = log.ops;
+    int op_count = log.count;
+
+    if (convert_path) {
+        int rc = write_oplog_binary(&log, convert_path);
+        if (rc == 0) printf("Wrote %d operations to %s\n", op_count, convert_path);
+        free_oplog(&log);
+        return rc == 0 ? 0 : 1;
+    }
+
+    if (!compare_all) {
+        reset_memory(total_memory_size);
+        replay(ops, op_count);
+        summarize();
+        if (show_latency) print_latency();
+        print_reclaim();
+        free_oplog(&log);
+        return 0;
+    }
+
+    printf("\n%-10s | %8s | %8s | %10s | %10s | %10s | %10s | %5s | %8s | %10s\n", "Strategy", "Failed",
+           "Avg ns", "Max ns", "Free KB", "Largest KB", "Internal", "Ratio", "Merges", "Moved KB");
+    for (int s = 0; s < NUM_STRATEGIES; s++) {
+        strategy = &strategies[s];
+        if (snapshot_every > 0) printf("--- %s ---\n", strategy->name);
+        reset_memory(total_memory_size);
+        replay(ops, op_count);
+        long total_free, internal;
+        int largest_free;
+        free_stats(&total_free, &largest_free, &internal);
+        printf("%-10s | %8ld | %8.0f | %10.0f | %10ld | %10d | %10ld | %5.2f | %8ld | %10ld\n", strategy->name,
+               alloc_failures, alloc_calls ? alloc_ns_total / alloc_calls : 0.0, alloc_ns_max, total_free,
+               largest_free, internal, total_free ? (double)(total_free - largest_free) / total_free : 0.0,
+               merges, bytes_moved);
+    }
+    free_oplog(&log);
     return 0;
-}
\ No newline at end of file
+}
@@ -1,119 +1,538 @@
 // MMU.c
 #include "common.h"
+#include "policy.h"
+#include "transport.h"
+#include "tlb.h"
+#include "stats.h"
+#include "prefetch.h"
+#include <pthread.h>
 
-int main() {
-    int shm_pt_id, shm_ffl_id, shm_lru_id, msg_id;
-    PageTable *pt_shm;
-    FreeFrameList *ffl_shm;
-    LRUCounter *lru_counter_shm;
+// Attached IPC resources and MMU state
+static SimConfig *cfg_shm;
+static PageTable *pt_shm;
+static FreeFrameList *ffl_shm;
+static LRUCounter *lru_counter_shm;
+static LRUList *lru_list_shm;
+static const ReplacementPolicy *policy;
+static _Atomic int processes_finished;
+
+// Worker threads (MMU_THREADS). Lock order: policy lock, then at most one
+// page-table stripe at a time; a hit releases its stripe before it takes the
+// policy lock, so the two paths never wait on each other in a cycle.
+// The locks are taken whenever a second thread exists (workers or the cleaner).
+static int mmu_threads = 1;
+static int mmu_locking;
+static int pt_stripes = 1;
+static pthread_mutex_t *pt_locks;            // Page-table stripe of process pid: pid % pt_stripes
+static pthread_mutex_t policy_lock = PTHREAD_MUTEX_INITIALIZER;   // Policy state, LRU list owners
+static pthread_mutex_t response_lock = PTHREAD_MUTEX_INITIALIZER; // Single-producer response ring
+
+// Background cleaner (MMU_FREE_LOW): when a fault leaves fewer than free_low
+// frames free it wakes the cleaner, which evicts pages until free_low frames
+// are free again (at most clean_batch per policy lock hold), writes back the
+// dirty ones and pushes the frames onto the free stack, so later faults pop a
+// frame instead of running replacement.
+static int free_low, clean_batch;
+static int clean_stop;
+static int clean_starved;                    // Last run found nothing resident: wait for a fault
+static pthread_mutex_t clean_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t clean_cond = PTHREAD_COND_INITIALIZER;
+
+static void stripe_lock(int pid) {
+    if (mmu_locking) pthread_mutex_lock(&pt_locks[pid % pt_stripes]);
+}
+
+static void stripe_unlock(int pid) {
+    if (mmu_locking) pthread_mutex_unlock(&pt_locks[pid % pt_stripes]);
+}
+
+static void policy_enter(void) {
+    if (mmu_locking) pthread_mutex_lock(&policy_lock);
+}
+
+static void policy_exit(void) {
+    if (mmu_locking) pthread_mutex_unlock(&policy_lock);
+}
+
+// Record an access: reference bit and compressed age in the PTE, full stamp in the frame's recency slot.
+// The caller holds the page's stripe; the global clock itself is atomic.
+static void note_access(PTE *pte, int frame) {
+    long now = __atomic_add_fetch(lru_counter_shm, 1, __ATOMIC_RELAXED);
+    pte->referenced = 1;
+    pte->age = now & PTE_AGE_MASK;
+    __atomic_store_n(&pol_recency[frame], now, __ATOMIC_RELAXED);
+}
+
+// Count a served reference (hit or fault) in the shared stats and the event ring
+static void account(int type, int pid, int page, int frame, long start) {
+    long now = stats_now_ns();
+    ProcStats *ps = &sim_stats->procs[pid];
+    stats_add(&ps->refs, 1);
+    if (type == EV_FAULT) {
+        stats_add(&sim_stats->faults, 1);
+        stats_add(&ps->faults, 1);
+        stats_hist(sim_stats->fault_hist, now - start);
+    } else {
+        stats_add(&sim_stats->hits, 1);
+        stats_hist(sim_stats->hit_hist, now - start);
+    }
+    stats_event(type, pid, page, frame, now);
+}
+
+// Unmap the page held by 'frame', which the policy has already detached, and
+// clear the frame's owner so a later victim() cannot pick it again before it is
+// reused. Returns 1 if the page was dirty and had to be written back.
+static int evict(int frame, long now) {
+    int victim_pid = lru_list_shm->nodes[frame].owner_pid;
+    int victim_page = lru_list_shm->nodes[frame].owner_page;
+    stripe_lock(victim_pid);
+    PTE *victim = pte_lookup(pt_shm, victim_pid, victim_page);
+    int dirty = victim->dirty;
+    if (victim->prefetched) {
+        victim->prefetched = 0;
+        stats_add(&sim_stats->prefetch_wasted, 1);
+        pf_outcome(victim_pid, 0);
+    }
+    victim->present = 0;
+    victim->referenced = 0;
+    victim->dirty = 0;
+    stripe_unlock(victim_pid);
+    tlb_invalidate(victim_pid, victim_page);
+    stats_add(&sim_stats->evictions, 1);
+    if (dirty) stats_add(&sim_stats->writebacks, 1);
+    lru_list_shm->nodes[frame].owner_pid = lru_list_shm->nodes[frame].owner_page = -1;
+    stats_event(EV_EVICT, victim_pid, victim_page, frame, now);
+    event_log("MMU: %s replacement. Evicting P%d, Page %d from Frame %d%s\n",
+              policy->name, victim_pid, victim_page, frame, dirty ? " (dirty, written back)" : "");
+    return dirty;
+}
+
+static void *cleaner(void *arg) {
+    (void)arg;
+    pthread_mutex_lock(&clean_lock);
+    for (;;) {
+        while (!clean_stop && (clean_starved || atomic_load(&ffl_shm->free_frame_count) >= free_low)) {
+            pthread_cond_wait(&clean_cond, &clean_lock);
+        }
+        if (clean_stop) break;
+        pthread_mutex_unlock(&clean_lock);
+        policy_enter();
+        long now = stats_now_ns();
+        int freed = 0, written = 0, frame;
+        while (freed < clean_batch && atomic_load(&ffl_shm->free_frame_count) < free_low &&
+               (frame = policy->victim()) != -1) {
+            written += evict(frame, now);
+            ffl_push(ffl_shm, frame);
+            freed++;
+        }
+        policy_exit();
+        if (freed > 0) {
+            stats_add(&sim_stats->cleaner_runs, 1);
+            stats_add(&sim_stats->cleaner_writebacks, written);
+        }
+        pthread_mutex_lock(&clean_lock);
+        if (freed == 0) clean_starved = 1;
+    }
+    pthread_mutex_unlock(&clean_lock);
+    return NULL;
+}
+
+static void cleaner_wake(int stop) {
+    pthread_mutex_lock(&clean_lock);
+    if (stop) clean_stop = 1;
+    clean_starved = 0;                       // A fault just loaded a page
+    pthread_cond_signal(&clean_cond);
+    pthread_mutex_unlock(&clean_lock);
+}
+
+// Read-ahead after a fault, in two steps under the policy lock
+typedef struct {
+    int count;
+    int pages[PF_MAX_PAGES], frames[PF_MAX_PAGES];
+    PTE *ptes[PF_MAX_PAGES];
+} Readahead;
+
+// Pick the pages to read ahead after pid faulted on page and take a frame for
+// each. Runs before the demand frame joins the policy, so victim() cannot hand
+// that frame back; and every frame is taken before any prefetched page joins,
+// so they cannot evict each other. A dirty victim adds 1 to *writebacks.
+static void prefetch_reserve(int pid, int page, Readahead *ra, int *writebacks) {
+    int pages[PF_MAX_PAGES];
+    stripe_lock(pid);
+    int n = pf_predict(pid, page, cfg_shm->num_pages, pages), k = 0;
+    for (int i = 0; i < n; i++) {
+        PTE *e = pte_lookup(pt_shm, pid, pages[i]);
+        if (e == NULL || e->present) continue; // Only into existing leaves: the pool is sized for demand faults
+        ra->ptes[k] = e;
+        ra->pages[k++] = pages[i];
+    }
+    stripe_unlock(pid);
+
+    long now = stats_now_ns();
+    ra->count = 0;
+    while (ra->count < k) {
+        int frame = ffl_pop(ffl_shm);
+        if (frame == -1) {
+            if ((frame = policy->victim()) == -1) break;
+            *writebacks += evict(frame, now);
+        }
+        ra->frames[ra->count++] = frame;
+    }
+    if (free_low > 0 && atomic_load(&ffl_shm->free_frame_count) < free_low) cleaner_wake(0);
+}
+
+// Load the reserved pages, after the demand page
+static void prefetch_load(int pid, const Readahead *ra) {
+    long now = stats_now_ns();
+    stripe_lock(pid);
+    for (int i = 0; i < ra->count; i++) {
+        PTE *e = ra->ptes[i];
+        note_access(e, ra->frames[i]);
+        e->frame_number = ra->frames[i];
+        e->present = 1;
+        e->referenced = 0;           // Loaded, not used: Clock's first candidate
+        e->dirty = 0;
+        e->prefetched = 1;
+    }
+    stripe_unlock(pid);
+    for (int i = 0; i < ra->count; i++) {
+        lru_list_shm->nodes[ra->frames[i]].owner_pid = pid;
+        lru_list_shm->nodes[ra->frames[i]].owner_page = ra->pages[i];
+        policy->on_load(ra->frames[i], pid, ra->pages[i]);
+        stats_event(EV_PREFETCH, pid, ra->pages[i], ra->frames[i], now);
+        event_log("MMU: Prefetched P%d, Page %d -> Frame %d\n", pid, ra->pages[i], ra->frames[i]);
+    }
+    stats_add(&sim_stats->prefetches, ra->count);
+}
+
+// Resolve one reference (page number, REF_WRITE if it writes) of a resident-or-not page.
+// Returns 2 (Hit), 1 (Page Fault, page now loaded), 3 if the page table pool
+// is exhausted (process terminated) or -1 if no frame could be found.
+// A fault that had to write back a dirty victim first adds 1 to *writebacks.
+static int handle_reference(int pid, int ref, int *writebacks) {
+    long start = stats_now_ns();
+    int page = REF_PAGE(ref), write = (ref & REF_WRITE) != 0;
+    // 2. Consult the TLB, then the Page Table (read-only walk; directories are only allocated on faults)
+    stripe_lock(pid);
+    if (pf_mode == PF_STRIDE) pf_observe(pid, page);
+    TLBEntry *te = tlb_lookup(pid, page);
+    PTE *pte = te != NULL ? te->pte : pte_lookup(pt_shm, pid, page);
+    if (pte != NULL && pte->present == 1) {
+        // Page Hit
+        int frame = pte->frame_number;
+        note_access(pte, frame);
+        if (write) pte->dirty = 1;
+        if (pte->prefetched) {
+            pte->prefetched = 0;
+            stats_add(&sim_stats->prefetch_hits, 1);
+            pf_outcome(pid, 1);
+        }
+        stripe_unlock(pid);
+        if (policy->on_hit != nop_hit) {
+            policy_enter();
+            // Another worker may have evicted the page since the stripe was released
+            LRUNode *owner = &lru_list_shm->nodes[frame];
+            if (owner->owner_pid == pid && owner->owner_page == page) policy->on_hit(frame);
+            policy_exit();
+        }
+        if (te == NULL) tlb_insert(pid, page, frame, pte);
+        account(EV_HIT, pid, page, frame, start);
+        return 2;
+    }
+
+    // Page Fault occurs
     
-    // Attach to IPC resources
-    shm_lru_id = shmget(SHM_LRU_COUNTER_KEY, sizeof(LRUCounter), 0666);
-    lru_counter_shm = (LRUCounter *)shmat(shm_lru_id, NULL, 0);
-    shm_pt_id = shmget(SHM_PAGE_TABLE_KEY, sizeof(PageTable), 0666);
-    pt_shm = (PageTable *)shmat(shm_pt_id, NULL, 0);
-    shm_ffl_id = shmget(SHM_FRAME_LIST_KEY, sizeof(FreeFrameList), 0666);
-    ffl_shm = (FreeFrameList *)shmat(shm_ffl_id, NULL, 0);
-    msg_id = msgget(MSG_QUEUE_KEY, 0666);
+    // 3. Page Fault Handler Routine
+    int frame_to_use = -1;
+    if (pte == NULL && (pte = pte_at(pt_shm, pid, page)) == NULL) {
+        stripe_unlock(pid);
+        fprintf(stderr, "MMU Error: page table pool exhausted (P%d, Page %d).\n", pid, page);
+        return 3;
+    }
+    // The process has no other request in flight, so nobody but an evicting worker
+    // (which needs the policy lock) touches this PTE until it is loaded below
+    stripe_unlock(pid);
+    policy_enter();
+    policy->on_miss(pid, page);
     
-    if (pt_shm == (void *)-1 || ffl_shm == (void *)-1 || lru_counter_shm == (void *)-1 || msg_id == -1) { 
-        perror("MMU shm/msg attach failed"); exit(1); 
+    if ((frame_to_use = ffl_pop(ffl_shm)) != -1) {
+        // Case A: Free frame available
+        if (free_low > 0 && atomic_load(&ffl_shm->free_frame_count) < free_low) cleaner_wake(0);
+    } else {
+        // Case B: No free frame, use the replacement policy
+        long t0 = stats_now_ns();
+        frame_to_use = policy->victim();
+        long t1 = stats_now_ns();
+        stats_add(&sim_stats->victim_ns, t1 - t0);
+        
+        // Evict Victim (the read waits for a dirty victim's write-back)
+        if (frame_to_use != -1) {
+            stats_add(&sim_stats->inline_evictions, 1);
+            *writebacks += evict(frame_to_use, t1);
+        } else {
+            // Should not happen if physical memory is full and the process is running
+            policy_exit();
+            fprintf(stderr, "MMU Error: No victim found despite full memory.\n");
+            return -1;
+        }
     }
+    
+    Readahead ra = {0};
+    if (pf_mode != PF_OFF) prefetch_reserve(pid, page, &ra, writebacks);
+
+    // 4. Load Page (Simulated I/O)
+    // The page is resident at once; the Scheduler charges the read time (SIM_FAULT_US)
+    stripe_lock(pid);
+    pte->frame_number = frame_to_use;
+    pte->present = 1;
+    pte->dirty = write;
+    note_access(pte, frame_to_use);
+    stripe_unlock(pid);
+    lru_list_shm->nodes[frame_to_use].owner_pid = pid;
+    lru_list_shm->nodes[frame_to_use].owner_page = page;
+    policy->on_load(frame_to_use, pid, page);
+    if (ra.count > 0) prefetch_load(pid, &ra);
+    policy_exit();
+    tlb_insert(pid, page, frame_to_use, pte);
+
+    account(EV_FAULT, pid, page, frame_to_use, start);
+    event_log("Page Fault handled for Process %d, Page %d -> Frame %d\n", pid, page, frame_to_use);
+    return 1;
+}
 
-    [cite_start]printf("MMU started.\n"); [cite: 27]
+static void respond(Transport *tp, Message *response) {
+    if (mmu_threads > 1 && tp->use_rings) pthread_mutex_lock(&response_lock);
+    send_response(tp, response);
+    if (mmu_threads > 1 && tp->use_rings) pthread_mutex_unlock(&response_lock);
+}
+
+// Answer a request that resolved response->count references. A hit with quantum
+// left goes straight back to the Process as a Ready_To_Run, so it keeps running
+// without a dispatch; anything else ends the slice and goes to the Scheduler,
+// with the quantum left in response->slice.
+static void reply(Transport *tp, Message *response) {
+    response->slice -= response->count;
+    if (response->status == 2 && response->slice > 0) {
+        Message cmd = {.sender_pid = response->sender_pid, .page_number = response->slice,
+                       .status = 4, .count = response->count};
+        send_command(tp, &cmd);
+        return;
+    }
+    respond(tp, response);
+}
 
-    while (1) {
+// A process is done, finished or terminated; returns 1 once this worker has nothing
+// left to serve (all of them for the message queue, its own request rings otherwise)
+static int process_done(Transport *tp, int *finished, int served) {
+    // Master waits for the MMU to exit once every process is done
+    int all = atomic_fetch_add(&processes_finished, 1) + 1 == cfg_shm->num_processes;
+    if (!(tp->use_rings ? ++*finished == served : all)) return 0;
+    // Workers blocked on the shared queue need a message to notice
+    for (int w = 1; all && !tp->use_rings && w < mmu_threads; w++) {
+        Message stop = {.sender_pid = -1, .page_number = -1, .status = 3};
+        send_request(tp, &stop);
+    }
+    return 1;
+}
+
+// Terminate the process behind 'response' (illegal reference, page table pool
+// exhausted): the Scheduler drops it on the status 3 response and the Process,
+// blocked until its next dispatch, exits on a status 3 command instead
+static int terminate(Transport *tp, Message *response, int *finished, int served) {
+    printf("MMU: Terminating Process %d.\n", response->sender_pid);
+    Message cmd = {.sender_pid = response->sender_pid, .page_number = -1, .status = 3};
+    send_command(tp, &cmd);
+    response->status = 3;
+    reply(tp, response);
+    return process_done(tp, finished, served);
+}
+
+// Request loop of one worker: returns once the processes it serves (all of
+// them for the message queue, its own request rings otherwise) have finished
+static void serve(Transport *tp, int served) {
+    int finished = 0;
+    for (;;) {
         Message request;
         // 1. Receive Page Request from Process
-        if (msgrcv(msg_id, &request, sizeof(Message) - sizeof(long), MT_PROCESS_REQUEST, 0) == -1) {
+        long wait_start = stats_now_ns();
+        if (recv_request(tp, &request) == -1) {
              // Check if the queue was removed by master (end of simulation)
              break;
         }
-        
+        stats_add(&sim_stats->mmu_wait_ns, stats_now_ns() - wait_start);
+    
         int pid = request.sender_pid;
-        int page = request.page_number;
-        
+        if (pid == -1) break; // Another worker saw the last process finish
+        int page = REF_PAGE(request.page_number);
+        Message response = {.sender_pid = pid, .count = 1, .slice = request.slice};
+        int writebacks = 0;
+    
         // Handle Process Finished signal sent through the same channel
         if (request.status == 3) {
-            Message response = {.mtype = MT_MMU_RESPONSE, .sender_pid = pid, .status = 3};
-            msgsnd(msg_id, &response, sizeof(Message) - sizeof(long), 0);
+            response.status = 3;
+            response.count = 0;
+            reply(tp, &response);
+            if (process_done(tp, &finished, served)) break;
+            continue;
+        }
+
+        if (request.status == 5) {
+            // Batch: resolve hits in bulk, stop at the first fault or the end of the batch
+            int k = 0, status = 2;
+            while (k < request.count && status == 2) {
+                page = REF_PAGE(request.pages[k]);
+                if (page >= cfg_shm->num_pages || page < 0) {
+                    printf("MMU: Illegal page reference by Process %d, Page %d.\n", pid, page);
+                    status = 3;
+                    break;
+                }
+                status = handle_reference(pid, request.pages[k++], &writebacks);
+            }
+            if (status == -1) continue;
+            // 5. Report the outcome of the last reference and how far the batch got
+            response.count = k;
+            response.page_number = writebacks;
+            if (status == 3) {
+                if (terminate(tp, &response, &finished, served)) break;
+                continue;
+            }
+            response.status = status;
+            reply(tp, &response);
             continue;
         }
 
-        [cite_start]printf("MMU: Process %d requests page %d\n", pid, page); [cite: 28]
+        event_log("MMU: Process %d requests page %d%s\n", pid, page, request.page_number & REF_WRITE ? " (write)" : "");
 
-        [cite_start]// Check for illegal reference [cite: 9]
-        if (page >= NUM_PAGES || page < 0) {
-            printf("MMU: Illegal page reference by Process %d, Page %d. Terminating process.\n", pid, page);
-            [cite_start]// In a real system, the process would be terminated [cite: 9]
-            Message response = {.mtype = MT_MMU_RESPONSE, .sender_pid = pid, .status = 3};
-            msgsnd(msg_id, &response, sizeof(Message) - sizeof(long), 0);
+        // Check for illegal reference
+        if (page >= cfg_shm->num_pages || page < 0) {
+            printf("MMU: Illegal page reference by Process %d, Page %d.\n", pid, page);
+            if (terminate(tp, &response, &finished, served)) break;
             continue;
         }
 
-        // 2. Consult Page Table
-        if (pt_shm->table[pid][page].present == 1) {
-            [cite_start]// Page Hit [cite: 9]
-            pt_shm->table[pid][page].last_access = ++(*lru_counter_shm);
-            // Send 'Hit' status to Scheduler
-            Message response = {.mtype = MT_MMU_RESPONSE, .sender_pid = pid, .status = 2};
-            msgsnd(msg_id, &response, sizeof(Message) - sizeof(long), 0);
-        } else {
-            [cite_start]// Page Fault occurs [cite: 10]
-            
-            [cite_start]// 3. Page Fault Handler Routine [cite: 12]
-            int frame_to_use = -1;
-            
-            if (ffl_shm->free_frame_count > 0) {
-                [cite_start]// Case A: Free frame available [cite: 13, 14]
-                frame_to_use = ffl_shm->free_frames[--ffl_shm->free_frame_count];
-            } else {
-                [cite_start]// Case B: No free frame, use LRU replacement [cite: 15]
-                int victim_pid = -1, victim_page = -1;
-                long min_lru_time = -1;
-                
-                // Find Victim Page (using LRU) 
-                for (int i = 0; i < NUM_PROCESSES; i++) {
-                    for (int j = 0; j < NUM_PAGES; j++) {
-                        if (pt_shm->table[i][j].present == 1) {
-                            if (min_lru_time == -1 || pt_shm->table[i][j].last_access < min_lru_time) {
-                                min_lru_time = pt_shm->table[i][j].last_access;
-                                victim_pid = i;
-                                victim_page = j;
-                            }
-                        }
-                    }
-                }
-                
-                // Evict Victim
-                if (victim_pid != -1) {
-                    frame_to_use = pt_shm->table[victim_pid][victim_page].frame_number;
-                    pt_shm->table[victim_pid][victim_page].present = 0;
-                    printf("MMU: LRU replacement. Evicting P%d, Page %d from Frame %d\n", 
-                           victim_pid, victim_page, frame_to_use);
-                } else {
-                    // Should not happen if physical memory is full and the process is running
-                    fprintf(stderr, "MMU Error: No victim found despite full memory.\n");
-                    continue; 
-                }
-            }
-            
-            [cite_start]// 4. Load Page (Simulated I/O) [cite: 10]
-            pt_shm->table[pid][page].frame_number = frame_to_use;
-            pt_shm->table[pid][page].present = 1;
-            pt_shm->table[pid][page].last_access = ++(*lru_counter_shm);
-            pt_shm->table[pid][page].process_id = pid;
-
-            [cite_start]printf("Page Fault handled for Process %d, Page %d -> Frame %d\n", pid, page, frame_to_use); [cite: 29, 31]
-            
-            [cite_start]// 5. Send 'Page Fault' status to Scheduler (context switch) [cite: 11]
-            Message response = {.mtype = MT_MMU_RESPONSE, .sender_pid = pid, .status = 1};
-            msgsnd(msg_id, &response, sizeof(Message) - sizeof(long), 0);
+        int status = handle_reference(pid, request.page_number, &writebacks);
+        if (status == -1) continue;
+        if (status == 3) {
+            if (terminate(tp, &response, &finished, served)) break;
+            continue;
         }
+    
+        // 5. Send 'Hit' or 'Page Fault' status to Scheduler (fault: context switch), or let a hit run on
+        response.status = status;
+        response.page_number = writebacks;
+        reply(tp, &response);
     }
+}
+
+static void *mmu_worker(void *arg) {
+    Transport *tp = arg;
+    tlb_init();
+    int stride = tp->request_ring_stride;
+    serve(tp, (cfg_shm->num_processes - tp->first_request_ring + stride - 1) / stride);
+    tlb_fold();
+    return NULL;
+}
+
+int main(int argc, char *argv[]) {
+    int shm_cfg_id, shm_pt_id, shm_ffl_id, shm_lru_id, shm_lrul_id;
+    Transport tp;
+    
+    // Attach to IPC resources (existing segments, sizes come from their headers)
+    shm_cfg_id = shmget(SHM_CONFIG_KEY, 0, 0666);
+    cfg_shm = (SimConfig *)shmat(shm_cfg_id, NULL, 0);
+    shm_lru_id = shmget(SHM_LRU_COUNTER_KEY, sizeof(LRUCounter), 0666);
+    lru_counter_shm = (LRUCounter *)shmat(shm_lru_id, NULL, 0);
+    shm_pt_id = shmget(SHM_PAGE_TABLE_KEY, 0, 0666);
+    pt_shm = (PageTable *)shmat(shm_pt_id, NULL, 0);
+    shm_ffl_id = shmget(SHM_FRAME_LIST_KEY, 0, 0666);
+    ffl_shm = (FreeFrameList *)shmat(shm_ffl_id, NULL, 0);
+    shm_lrul_id = shmget(SHM_LRU_LIST_KEY, 0, 0666);
+    lru_list_shm = (LRUList *)shmat(shm_lrul_id, NULL, 0);
+    int tp_status = transport_attach(&tp);
+    int stats_status = stats_attach();
     
-    [cite_start]printf("MMU terminating.\n"); [cite: 33]
+    if (cfg_shm == (void *)-1 || pt_shm == (void *)-1 || ffl_shm == (void *)-1 || lru_counter_shm == (void *)-1 ||
+        lru_list_shm == (void *)-1 || tp_status == -1 || stats_status == -1) { 
+        perror("MMU shm/msg attach failed"); exit(1); 
+    }
+
+    // Replacement policy: first argument, else MMU_POLICY, else LRU
+    const char *policy_name = argc > 1 ? argv[1] : env_str("MMU_POLICY", "lru");
+    policy = policy_select(policy_name, pt_shm, lru_list_shm);
+    if (policy == NULL) {
+        fprintf(stderr, "MMU: unknown replacement policy '%s'\n", policy_name);
+        exit(1);
+    }
+
+    if (pf_init(cfg_shm->num_processes) == -1) {
+        fprintf(stderr, "MMU: unknown prefetch mode '%s' (off, seq, stride)\n", env_str("MMU_PREFETCH", ""));
+        exit(1);
+    }
+    tlb_init();
+    mmu_threads = atoi(env_str("MMU_THREADS", "1"));
+    if (mmu_threads > cfg_shm->num_processes) mmu_threads = cfg_shm->num_processes;
+    if (mmu_threads < 1) mmu_threads = 1;
+
+    free_low = atoi(env_str("MMU_FREE_LOW", "0"));
+    if (free_low >= cfg_shm->num_frames) free_low = cfg_shm->num_frames - 1;
+    if (free_low < 0) free_low = 0;
+    clean_batch = atoi(env_str("MMU_CLEAN_BATCH", "16"));
+    if (clean_batch > cfg_shm->num_frames - free_low) clean_batch = cfg_shm->num_frames - free_low;
+    if (clean_batch < 1) clean_batch = 1;
+
+    printf("MMU started.\n");
+    printf("MMU: Replacement policy %s.\n", policy->name);
+    if (pf_mode != PF_OFF) {
+        printf("MMU: prefetch %s, up to %d pages%s.\n", pf_name(), pf_max, pf_adapt ? ", adaptive window" : "");
+    }
+
+    mmu_locking = mmu_threads > 1 || free_low > 0;
+    if (mmu_locking) {
+        pt_stripes = atoi(env_str("MMU_LOCK_STRIPES", "64"));
+        if (pt_stripes < 1) pt_stripes = 1;
+        pt_locks = malloc(pt_stripes * sizeof(pthread_mutex_t));
+        for (int i = 0; i < pt_stripes; i++) pthread_mutex_init(&pt_locks[i], NULL);
+        pol_pte_lock = stripe_lock;
+        pol_pte_unlock = stripe_unlock;
+    }
+    pthread_t clean_thread;
+    if (free_low > 0) {
+        pthread_create(&clean_thread, NULL, cleaner, NULL);
+        printf("MMU: page cleaner keeps %d frames free, %d per batch.\n", free_low, clean_batch);
+    }
+
+    if (mmu_threads == 1) {
+        serve(&tp, cfg_shm->num_processes);
+    } else {
+        printf("MMU: %d worker threads, %d page-table lock stripes.\n", mmu_threads, pt_stripes);
+
+        // Worker w pops the request rings of processes w, w + n, ... (any request with msgq)
+        Transport *workers = malloc(mmu_threads * sizeof(Transport));
+        pthread_t *threads = malloc(mmu_threads * sizeof(pthread_t));
+        for (int w = 0; w < mmu_threads; w++) {
+            workers[w] = tp;
+            workers[w].first_request_ring = w;
+            workers[w].request_ring_stride = mmu_threads;
+            pthread_create(&threads[w], NULL, mmu_worker, &workers[w]);
+        }
+        for (int w = 0; w < mmu_threads; w++) pthread_join(threads[w], NULL);
+        free(workers); free(threads);
+    }
+    if (free_low > 0) {
+        cleaner_wake(1);
+        pthread_join(clean_thread, NULL);
+    }
+
+    printf("MMU: %s: %ld hits, %ld faults, %ld evictions (%ld dirty), %.0f ns per inline victim selection\n",
+           policy->name, (long)sim_stats->hits, (long)sim_stats->faults, (long)sim_stats->evictions,
+           (long)sim_stats->writebacks,
+           sim_stats->inline_evictions ? (double)sim_stats->victim_ns / sim_stats->inline_evictions : 0.0);
+    tlb_report();
+    printf("MMU: page table: %ld leaves, %ld directories, %zu of %zu KB in use\n",
+           pt_shm->leaves, pt_shm->dirs, pt_shm->pool_used / 1024, pt_shm->pool_size / 1024);
+    printf("MMU terminating.\n");
     // Detach shared memory
-    shmdt(pt_shm); shmdt(ffl_shm); shmdt(lru_counter_shm);
+    shmdt(cfg_shm); shmdt(pt_shm); shmdt(ffl_shm); shmdt(lru_counter_shm); shmdt(lru_list_shm); shmdt(sim_stats);
+    transport_detach(&tp);
     return 0;
 }
\ No newline at end of file
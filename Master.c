@@ -1,48 +1,114 @@
 // Master.c
 #include "common.h"
+#include "pagetable.h"
+#include "transport.h"
+#include "stats.h"
+#include "workload.h"
 
-int main() {
-    int shm_pt_id, shm_ffl_id, shm_lru_id, msg_id;
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-p processes] [-n pages_per_process] [-f frames] [-r reference_string_len]\n", prog);
+    exit(1);
+}
+
+int main(int argc, char *argv[]) {
+    int shm_cfg_id, shm_pt_id, shm_ffl_id, shm_lru_id, shm_lrul_id, shm_rings_id, shm_stats_id, msg_id;
+    SimConfig cfg = {DEFAULT_NUM_PROCESSES, DEFAULT_NUM_PAGES, DEFAULT_NUM_FRAMES, DEFAULT_REFERENCE_STRING_LEN};
+    SimConfig *cfg_shm;
     PageTable *pt_shm;
     FreeFrameList *ffl_shm;
     LRUCounter *lru_counter_shm;
+    LRUList *lru_list_shm;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "p:n:f:r:")) != -1) {
+        switch (opt) {
+        case 'p': cfg.num_processes = atoi(optarg); break;
+        case 'n': cfg.num_pages = atoi(optarg); break;
+        case 'f': cfg.num_frames = atoi(optarg); break;
+        case 'r': cfg.reference_string_len = atoi(optarg); break;
+        default: usage(argv[0]);
+        }
+    }
+    if (cfg.num_processes <= 0 || cfg.num_pages <= 0 || cfg.num_frames <= 0 || cfg.reference_string_len <= 0) {
+        usage(argv[0]);
+    }
+
+    // Reject a bad SIM_WORKLOAD here, before any Process could fail on it mid-run
+    Workload wl;
+    const char *spec = env_str("SIM_WORKLOAD", "uniform");
+    if (workload_open(&wl, spec, cfg.num_pages) == -1) exit(1);
+    workload_close(&wl);
+
+    printf("Master: Starting Simulation... (%d processes, %d pages each, %d frames, %d references, %s)\n",
+           cfg.num_processes, cfg.num_pages, cfg.num_frames, cfg.reference_string_len, spec);
 
-    printf("Master: Starting Simulation...\n");
+    // 0. Publish the dimensions every module sizes its view from
+    shm_cfg_id = shm_create(SHM_CONFIG_KEY, sizeof(SimConfig));
+    if (shm_cfg_id == -1) { perror("shmget config"); exit(1); }
+    cfg_shm = (SimConfig *)shmat(shm_cfg_id, NULL, 0);
+    if (cfg_shm == (void *)-1) { perror("shmat config"); exit(1); }
+    *cfg_shm = cfg;
 
     // 1. Initialize Shared Memory for LRU Counter
-    shm_lru_id = shmget(SHM_LRU_COUNTER_KEY, sizeof(LRUCounter), IPC_CREAT | 0666);
+    shm_lru_id = shm_create(SHM_LRU_COUNTER_KEY, sizeof(LRUCounter));
     if (shm_lru_id == -1) { perror("shmget lru"); exit(1); }
     lru_counter_shm = (LRUCounter *)shmat(shm_lru_id, NULL, 0);
     if (lru_counter_shm == (void *)-1) { perror("shmat lru"); exit(1); }
     *lru_counter_shm = 0; // Initialize global time counter
 
     // 2. Initialize Shared Memory for Page Table
-    shm_pt_id = shmget(SHM_PAGE_TABLE_KEY, sizeof(PageTable), IPC_CREAT | 0666);
+    // Sized for the worst case (every reference a new page); the kernel only
+    // backs the parts of the pool that directories and leaves actually use.
+    long touched = cfg.reference_string_len < cfg.num_pages ? cfg.reference_string_len : cfg.num_pages;
+    size_t pt_size = pt_segment_size(cfg.num_processes, cfg.num_pages, touched);
+    shm_pt_id = shm_create(SHM_PAGE_TABLE_KEY, pt_size); // Fresh segment: the pool must start zeroed
     if (shm_pt_id == -1) { perror("shmget pt"); exit(1); }
     pt_shm = (PageTable *)shmat(shm_pt_id, NULL, 0);
     if (pt_shm == (void *)-1) { perror("shmat pt"); exit(1); }
     
-    // Initialize Page Table: present = 0
-    memset(pt_shm, 0, sizeof(PageTable));
+    // Initialize Page Table: no directories or leaves yet, so every page is non-present
+    pt_init(pt_shm, cfg.num_processes, cfg.num_pages, pt_size);
 
     // 3. Initialize Shared Memory for Free Frame List
-    shm_ffl_id = shmget(SHM_FRAME_LIST_KEY, sizeof(FreeFrameList), IPC_CREAT | 0666);
+    shm_ffl_id = shm_create(SHM_FRAME_LIST_KEY, FREE_FRAME_LIST_SIZE(cfg.num_frames));
     if (shm_ffl_id == -1) { perror("shmget ffl"); exit(1); }
     ffl_shm = (FreeFrameList *)shmat(shm_ffl_id, NULL, 0);
     if (ffl_shm == (void *)-1) { perror("shmat ffl"); exit(1); }
 
-    // Initialize Free Frame List: all frames available
-    ffl_shm->free_frame_count = NUM_FRAMES;
-    for (int i = 0; i < NUM_FRAMES; i++) {
-        ffl_shm->free_frames[i] = NUM_FRAMES - 1 - i; // Fill the stack
+    // Initialize Free Frame List: all frames available, frame 0 on top
+    ffl_shm->num_frames = cfg.num_frames;
+    atomic_store(&ffl_shm->free_frame_count, 0);
+    atomic_store(&ffl_shm->top, 0);
+    for (int i = cfg.num_frames - 1; i >= 0; i--) ffl_push(ffl_shm, i); // Fill the stack
+
+    // Initialize LRU List: empty, no frame is resident yet
+    shm_lrul_id = shm_create(SHM_LRU_LIST_KEY, LRU_LIST_SIZE(cfg.num_frames));
+    if (shm_lrul_id == -1) { perror("shmget lru list"); exit(1); }
+    lru_list_shm = (LRUList *)shmat(shm_lrul_id, NULL, 0);
+    if (lru_list_shm == (void *)-1) { perror("shmat lru list"); exit(1); }
+    lru_list_shm->num_frames = cfg.num_frames;
+    lru_list_shm->head = lru_list_shm->tail = -1;
+    for (int i = 0; i < cfg.num_frames; i++) {
+        lru_list_shm->nodes[i].prev = lru_list_shm->nodes[i].next = -1;
+        lru_list_shm->nodes[i].owner_pid = lru_list_shm->nodes[i].owner_page = -1;
     }
 
     // 4. Initialize Message Queue
     msg_id = msgget(MSG_QUEUE_KEY, IPC_CREAT | 0666);
     if (msg_id == -1) { perror("msgget"); exit(1); }
 
+    // Ring transport (used when SIM_TRANSPORT=ring)
+    shm_rings_id = transport_create(cfg.num_processes);
+    if (shm_rings_id == -1) { perror("shmget rings"); exit(1); }
+
+    // Counters, histograms and the event ring every module reports into
+    shm_stats_id = stats_create(cfg.num_processes);
+    if (shm_stats_id == -1) { perror("shmget stats"); exit(1); }
+
     printf("Master: IPC resources created. Starting modules...\n");
-    char pid_str[10];
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    char pid_str[16];
 
     // 5. Create Child Processes (MMU, Scheduler, Processes)
     // MMU
@@ -58,7 +124,7 @@ int main() {
     }
 
     // Processes
-    for (int i = 0; i < NUM_PROCESSES; i++) {
+    for (int i = 0; i < cfg.num_processes; i++) {
         if (fork() == 0) {
             sprintf(pid_str, "%d", i);
             execlp("./Process", "Process", pid_str, NULL);
@@ -67,18 +133,39 @@ int main() {
     }
 
     // 6. Wait for all children to finish
-    int active_children = NUM_PROCESSES + 2;
+    int active_children = cfg.num_processes + 2;
     while (active_children > 0) {
         wait(NULL);
         active_children--;
     }
 
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
     printf("Master: All modules terminated. Starting cleanup...\n");
 
+    // Summary from the stats segment, and the event trace if one was requested
+    SimStats *stats_shm = (SimStats *)shmat(shm_stats_id, NULL, 0);
+    if (stats_shm != (void *)-1) {
+        stats_report(stats_shm);
+        long refs = stats_shm->hits + stats_shm->faults;
+        printf("Master: %ld references in %.3f s (%.0f refs/s)\n", refs, elapsed, elapsed > 0 ? refs / elapsed : 0.0);
+        const char *trace_path = env_str("SIM_TRACE_FILE", NULL);
+        if (trace_path && stats_shm->event_capacity > 0 && stats_write_trace(stats_shm, trace_path) == 0) {
+            printf("Master: %lu events written to %s\n",
+                   stats_shm->events < stats_shm->event_capacity ? stats_shm->events : stats_shm->event_capacity,
+                   trace_path);
+        }
+        shmdt(stats_shm);
+    }
+
     // 7. Cleanup
+    shmdt(cfg_shm); shmctl(shm_cfg_id, IPC_RMID, NULL);
     shmdt(pt_shm); shmctl(shm_pt_id, IPC_RMID, NULL);
     shmdt(ffl_shm); shmctl(shm_ffl_id, IPC_RMID, NULL);
     shmdt(lru_counter_shm); shmctl(shm_lru_id, IPC_RMID, NULL);
+    shmdt(lru_list_shm); shmctl(shm_lrul_id, IPC_RMID, NULL);
+    shmctl(shm_rings_id, IPC_RMID, NULL);
+    shmctl(shm_stats_id, IPC_RMID, NULL);
     msgctl(msg_id, IPC_RMID, NULL);
 
     printf("Master: IPC resources released. Simulation finished.\n");
@@ -0,0 +1,112 @@
+// PTEBench.c
+// Compares the old array-of-structs PTE (one 32-byte record per page, recency
+// inside it) with the packed 8-byte PTE plus a per-frame recency array, on
+// the two operations the MMU performs most: updating the accessed state on a
+// hit and scanning for the least recently used page.
+//
+// Usage: PTEBench [pages] [frames] [refs]   (defaults 1048576 4096 20000000)
+#include "common.h"
+#include "workload.h"
+
+// Layout before the packed PTE
+typedef struct {
+    int frame_number;
+    int present;
+    long last_access;
+    int process_id;
+    int referenced;
+    int ghost;
+} OldPTE;
+
+static double now_sec(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+
+int main(int argc, char *argv[]) {
+    int pages = argc > 1 ? atoi(argv[1]) : 1 << 20;
+    int frames = argc > 2 ? atoi(argv[2]) : 4096;
+    long refs = argc > 3 ? atol(argv[3]) : 20000000;
+    if (frames > pages) frames = pages;
+
+    OldPTE *old = calloc(pages, sizeof(OldPTE));
+    PTE *pte = calloc(pages, sizeof(PTE));
+    long *recency = calloc(frames, sizeof(long));
+    int *page_of = malloc(frames * sizeof(int));
+    int *refstr = malloc(refs * sizeof(int));
+
+    // Resident pages spread over the whole table, references hit them only
+    for (int f = 0; f < frames; f++) {
+        int p = (int)(((long)f * pages) / frames);
+        page_of[f] = p;
+        old[p] = (OldPTE){f, 1, 0, 0, 0, 0};
+        pte[p].frame_number = f;
+        pte[p].present = 1;
+    }
+    // Fixed seed so both layouts see the same reference string
+    Rng rng;
+    rng_seed(&rng, 1, 0);
+    for (long i = 0; i < refs; i++) refstr[i] = page_of[rng_below(&rng, frames)];
+
+    printf("PTEBench: %d pages, %d frames, %ld hits; sizeof(PTE) %zu -> %zu bytes\n",
+           pages, frames, refs, sizeof(OldPTE), sizeof(PTE));
+
+    // 1. Hit path: set reference bit and recency stamp
+    long clock = 0;
+    double t0 = now_sec();
+    for (long i = 0; i < refs; i++) {
+        OldPTE *e = &old[refstr[i]];
+        e->last_access = ++clock;
+        e->referenced = 1;
+    }
+    double old_hit = now_sec() - t0;
+
+    clock = 0;
+    t0 = now_sec();
+    for (long i = 0; i < refs; i++) {
+        PTE *e = &pte[refstr[i]];
+        long stamp = ++clock;
+        e->referenced = 1;
+        e->age = stamp & PTE_AGE_MASK;
+        recency[e->frame_number] = stamp;
+    }
+    double new_hit = now_sec() - t0;
+
+    // 2. Victim search: minimum recency among resident pages
+    int scans = 20;
+    long sink = 0;
+    t0 = now_sec();
+    for (int s = 0; s < scans; s++) {
+        int best = -1;
+        for (int p = 0; p < pages; p++) {
+            if (old[p].present && (best == -1 || old[p].last_access < old[best].last_access)) best = p;
+        }
+        sink += best;
+        old[best].last_access = ++clock; // Refresh so the next scan picks another page
+    }
+    double old_scan = (now_sec() - t0) / scans;
+
+    t0 = now_sec();
+    for (int s = 0; s < scans; s++) {
+        int best = 0;
+        for (int f = 1; f < frames; f++) {
+            if (recency[f] < recency[best]) best = f;
+        }
+        sink += page_of[best];
+        recency[best] = ++clock;
+    }
+    double new_scan = (now_sec() - t0) / scans;
+
+    printf("hit update   : old %7.2f ns/ref   packed+SoA %7.2f ns/ref   (%.2fx)\n",
+           old_hit * 1e9 / refs, new_hit * 1e9 / refs, old_hit / new_hit);
+    printf("victim scan  : old %7.3f ms/scan  packed+SoA %7.3f ms/scan  (%.1fx)\n",
+           old_scan * 1e3, new_scan * 1e3, old_scan / new_scan);
+    printf("table memory : old %zu KB  packed %zu KB + recency %zu KB  (checksum %ld)\n",
+           pages * sizeof(OldPTE) / 1024, pages * sizeof(PTE) / 1024,
+           frames * sizeof(long) / 1024, sink);
+
+    free(old); free(pte); free(recency); free(page_of); free(refstr);
+    return 0;
+}
@@ -3,136 +3,759 @@
 #include <stdlib.h>
 #include <time.h>
 #include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "trace.h"
+#include "workload.h"
 
-#define MAX_PAGES 100 // Length of the reference string
+#define MAX_PAGES 100 // Length of the random reference string
 #define MIN_FRAMES 1
-#define MAX_FRAMES 7  // Number of page frames varies from 1 to 7 [cite: 37]
-#define PAGE_RANGE 10 // Page numbers range from 0 to 9 [cite: 36]
+#define MAX_FRAMES 7  // Number of page frames varies from 1 to 7
+#define PAGE_RANGE 10 // Page numbers range from 0 to 9
+
+// --- Page -> frame map for O(1) hit detection ---
+// Direct-indexed when the trace's page range is small, otherwise an
+// open-addressing hash holding only the resident pages.
+#define PM_DIRECT_LIMIT (1UL << 22)
+
+typedef struct {
+    int direct;
+    unsigned long count;    // Hash: pages stored
+    unsigned long mask;     // Hash: buckets - 1
+    unsigned long *key;     // Hash: page + 1, 0 = empty bucket
+    long *frame;            // Value per page (direct) or per bucket (hash), -1 = absent
+} PageMap;
+
+static void pm_init(PageMap *m, unsigned long max_page, int frames) {
+    memset(m, 0, sizeof(*m));
+    if (max_page < PM_DIRECT_LIMIT) {
+        m->direct = 1;
+        m->frame = malloc((max_page + 1) * sizeof(long));
+        memset(m->frame, -1, (max_page + 1) * sizeof(long));
+        return;
+    }
+    unsigned long cap = 16;
+    while (cap < 2UL * frames) cap <<= 1;
+    m->mask = cap - 1;
+    m->key = calloc(cap, sizeof(unsigned long));
+    m->frame = malloc(cap * sizeof(long));
+}
+
+static void pm_free(PageMap *m) {
+    free(m->key);
+    free(m->frame);
+}
+
+static inline unsigned long pm_bucket(const PageMap *m, unsigned long page) {
+    unsigned long k = (page + 1) * 0x9e3779b97f4a7c15UL;
+    unsigned long i = (k >> 29) & m->mask;
+    while (m->key[i] != 0 && m->key[i] != page + 1) i = (i + 1) & m->mask;
+    return i;
+}
+
+// Value stored for 'page' (usually its frame), or -1
+static inline long pm_get(const PageMap *m, unsigned long page) {
+    if (m->direct) return m->frame[page];
+    unsigned long i = pm_bucket(m, page);
+    return m->key[i] ? m->frame[i] : -1;
+}
+
+static void pm_put(PageMap *m, unsigned long page, long frame);
+
+// Double the hash when it passes half full
+static void pm_grow(PageMap *m) {
+    unsigned long old_cap = m->mask + 1;
+    unsigned long *old_key = m->key;
+    long *old_frame = m->frame;
+    m->mask = 2 * old_cap - 1;
+    m->count = 0;
+    m->key = calloc(2 * old_cap, sizeof(unsigned long));
+    m->frame = malloc(2 * old_cap * sizeof(long));
+    for (unsigned long i = 0; i < old_cap; i++) {
+        if (old_key[i]) pm_put(m, old_key[i] - 1, old_frame[i]);
+    }
+    free(old_key);
+    free(old_frame);
+}
+
+static inline void pm_put(PageMap *m, unsigned long page, long frame) {
+    if (m->direct) { m->frame[page] = frame; return; }
+    unsigned long i = pm_bucket(m, page);
+    if (m->key[i] == 0) {
+        if (2 * (m->count + 1) > m->mask + 1) {
+            pm_grow(m);
+            i = pm_bucket(m, page);
+        }
+        m->count++;
+    }
+    m->key[i] = page + 1;
+    m->frame[i] = frame;
+}
+
+// Linear-probing delete with backward shift (no tombstones)
+static inline void pm_del(PageMap *m, unsigned long page) {
+    if (m->direct) { m->frame[page] = -1; return; }
+    unsigned long i = pm_bucket(m, page);
+    if (m->key[i] == 0) return;
+    m->count--;
+    for (unsigned long j = (i + 1) & m->mask; m->key[j] != 0; j = (j + 1) & m->mask) {
+        unsigned long h = (((m->key[j]) * 0x9e3779b97f4a7c15UL) >> 29) & m->mask;
+        if (((j - h) & m->mask) >= ((j - i) & m->mask)) {
+            m->key[i] = m->key[j];
+            m->frame[i] = m->frame[j];
+            i = j;
+        }
+    }
+    m->key[i] = 0;
+}
 
 // Function to simulate FIFO algorithm
-int fifo(int frames, int *ref_string, int len) {
-    int page_faults = 0;
-    int memory[MAX_FRAMES];
+long fifo(int frames, const Trace *t) {
+    long page_faults = 0;
+    unsigned long *memory = malloc(frames * sizeof(unsigned long));
     int next_replace_index = 0;
-    
-    for (int i = 0; i < MAX_FRAMES; i++) memory[i] = -1; // -1 means empty
-
-    for (int i = 0; i < len; i++) {
-        int page = ref_string[i];
-        int hit = 0;
+    int used = 0;
+    PageMap map;
+    pm_init(&map, t->max_page, frames);
 
+    TraceCursor c = trace_cursor(t);
+    unsigned long page;
+    while (trace_next(&c, &page)) {
         // Check for hit
-        for (int j = 0; j < frames; j++) {
-            if (memory[j] == page) {
-                hit = 1;
-                break;
-            }
+        if (pm_get(&map, page) != -1) continue;
+
+        // Page Fault: replace the page at the next_replace_index (FIFO)
+        page_faults++;
+        if (used == frames) {
+            pm_del(&map, memory[next_replace_index]);
+        } else {
+            used++;
         }
+        memory[next_replace_index] = page;
+        pm_put(&map, page, next_replace_index);
+        next_replace_index = (next_replace_index + 1) % frames;
+    }
+    pm_free(&map);
+    free(memory);
+    return page_faults;
+}
 
-        if (!hit) {
-            // Page Fault
+// Function to simulate LRU algorithm
+// Frames form a recency list (head = most recent), so a hit is an O(1)
+// move to the head and the victim is always the tail.
+long lru(int frames, const Trace *t) {
+    long page_faults = 0;
+    unsigned long *memory = malloc(frames * sizeof(unsigned long));
+    int *prev = malloc(frames * sizeof(int));
+    int *next = malloc(frames * sizeof(int));
+    int head = -1, tail = -1;
+    int used = 0;
+    PageMap map;
+    pm_init(&map, t->max_page, frames);
+
+    TraceCursor c = trace_cursor(t);
+    unsigned long page;
+    while (trace_next(&c, &page)) {
+        int f = pm_get(&map, page);
+
+        if (f != -1) {
+            // Page Hit: move to the head of the recency list
+            if (f == head) continue;
+            next[prev[f]] = next[f];
+            if (next[f] != -1) prev[next[f]] = prev[f]; else tail = prev[f];
+        } else {
+            // Page Fault: use an empty frame, otherwise replace the LRU page (tail)
             page_faults++;
-            // Replace the page at the next_replace_index (FIFO)
-            memory[next_replace_index] = page;
-            next_replace_index = (next_replace_index + 1) % frames;
+            if (used < frames) {
+                f = used++;
+            } else {
+                f = tail;
+                pm_del(&map, memory[f]);
+                tail = prev[f];
+                if (tail != -1) next[tail] = -1; else head = -1;
+            }
+            memory[f] = page;
+            pm_put(&map, page, f);
         }
+        prev[f] = -1;
+        next[f] = head;
+        if (head != -1) prev[head] = f; else tail = f;
+        head = f;
     }
+    pm_free(&map);
+    free(memory);
+    free(prev);
+    free(next);
     return page_faults;
 }
 
-// Function to simulate LRU algorithm
-int lru(int frames, int *ref_string, int len) {
-    int page_faults = 0;
-    int memory[MAX_FRAMES];
-    long last_used[MAX_FRAMES];
-    long timer = 0; // Simulated time for tracking usage
-    
-    for (int i = 0; i < MAX_FRAMES; i++) {
-        memory[i] = -1;
-        last_used[i] = 0;
+// --- Belady's optimal algorithm (OPT): evict the page used furthest in the future ---
+// opt_prepare() builds next_use[i] (position of the next reference to the same
+// page, or the trace length if none) in one backward pass. Resident frames sit
+// in a max-heap keyed by their page's next use, so each reference is
+// O(log frames). Built once and shared read-only by every OPT job.
+static const uint32_t *opt_refs;
+static uint32_t *opt_owned;         // Text traces: decoded copy of the references
+static long *opt_next_use;
+
+static void opt_prepare(const Trace *t) {
+    opt_refs = t->refs;
+    if (opt_refs == NULL) {
+        opt_owned = malloc(t->count * sizeof(uint32_t));
+        TraceCursor c = trace_cursor(t);
+        unsigned long page;
+        for (long i = 0; trace_next(&c, &page); i++) opt_owned[i] = (uint32_t)page;
+        opt_refs = opt_owned;
     }
+    opt_next_use = malloc(t->count * sizeof(long));
+    PageMap seen;
+    pm_init(&seen, t->max_page, 1024);
+    for (long i = t->count - 1; i >= 0; i--) {
+        long n = pm_get(&seen, opt_refs[i]);
+        opt_next_use[i] = n == -1 ? t->count : n;
+        pm_put(&seen, opt_refs[i], i);
+    }
+    pm_free(&seen);
+}
 
-    for (int i = 0; i < len; i++) {
-        int page = ref_string[i];
-        int hit_index = -1;
+static void heap_swap(int *heap, int *pos, int a, int b) {
+    int fa = heap[a], fb = heap[b];
+    heap[a] = fb; pos[fb] = a;
+    heap[b] = fa; pos[fa] = b;
+}
 
-        // Check for hit and update usage
-        for (int j = 0; j < frames; j++) {
-            if (memory[j] == page) {
-                hit_index = j;
-                break;
+// Restore the max-heap property around slot i after key[heap[i]] changed
+static void heap_fix(int *heap, int *pos, const long *key, int n, int i) {
+    while (i > 0 && key[heap[(i - 1) / 2]] < key[heap[i]]) {
+        heap_swap(heap, pos, i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+    for (;;) {
+        int l = 2 * i + 1, r = l + 1, big = i;
+        if (l < n && key[heap[l]] > key[heap[big]]) big = l;
+        if (r < n && key[heap[r]] > key[heap[big]]) big = r;
+        if (big == i) break;
+        heap_swap(heap, pos, i, big);
+        i = big;
+    }
+}
+
+long opt(int frames, const Trace *t) {
+    long page_faults = 0;
+    unsigned long *memory = malloc(frames * sizeof(unsigned long));
+    long *next = malloc(frames * sizeof(long));    // Next use of the page in each frame
+    int *heap = malloc(frames * sizeof(int));      // Frames, furthest next use on top
+    int *pos = malloc(frames * sizeof(int));       // Heap slot of each frame
+    int used = 0;
+    PageMap map;
+    pm_init(&map, t->max_page, frames);
+
+    for (long i = 0; i < t->count; i++) {
+        unsigned long page = opt_refs[i];
+        int f = pm_get(&map, page);
+        if (f == -1) {
+            // Page Fault: use an empty frame, otherwise evict the top of the heap
+            page_faults++;
+            if (used < frames) {
+                f = used++;
+                heap[f] = f;
+                pos[f] = f;
+            } else {
+                f = heap[0];
+                pm_del(&map, memory[f]);
             }
+            memory[f] = page;
+            pm_put(&map, page, f);
         }
-        
-        if (hit_index != -1) {
-            // Page Hit: Update LRU timestamp
-            last_used[hit_index] = ++timer;
-        } else {
-            // Page Fault
-            page_faults++;
-            int empty_index = -1;
+        next[f] = opt_next_use[i];
+        heap_fix(heap, pos, next, used, pos[f]);
+    }
+    pm_free(&map);
+    free(memory);
+    free(next);
+    free(heap);
+    free(pos);
+    return page_faults;
+}
 
-            // 1. Check for empty frame
-            for (int j = 0; j < frames; j++) {
-                if (memory[j] == -1) {
-                    empty_index = j;
-                    break;
-                }
-            }
-            
-            if (empty_index != -1) {
-                // Load into empty frame
-                memory[empty_index] = page;
-                last_used[empty_index] = ++timer;
+// --- Working set ---
+// Virtual time is the reference index; a page belongs to the working set if it
+// was referenced within the last ws_window references (-w, default 4 x frames).
+static long ws_window;
+
+// WSClock: a clock hand over a fixed set of frames. A referenced frame gets a
+// second chance; an unreferenced one is evicted once it has left the window.
+// The hand examines at most WSCLOCK_SCAN frames per fault; if none has left
+// the window, the least recently used unreferenced frame examined goes.
+#define WSCLOCK_SCAN 32
+
+long wsclock(int frames, const Trace *t) {
+    long page_faults = 0;
+    long window = ws_window > 0 ? ws_window : 4L * frames;
+    unsigned long *memory = malloc(frames * sizeof(unsigned long));
+    long *last_use = malloc(frames * sizeof(long));
+    char *referenced = malloc(frames);
+    int used = 0, hand = 0;
+    PageMap map;
+    pm_init(&map, t->max_page, frames);
+
+    TraceCursor c = trace_cursor(t);
+    unsigned long page;
+    for (long now = 0; trace_next(&c, &page); now++) {
+        int f = pm_get(&map, page);
+        if (f == -1) {
+            page_faults++;
+            if (used < frames) {
+                f = used++;
             } else {
-                // 2. No empty frame, find LRU victim
-                int lru_index = 0;
-                long min_lru_time = last_used[0];
-
-                for (int j = 1; j < frames; j++) {
-                    if (last_used[j] < min_lru_time) {
-                        min_lru_time = last_used[j];
-                        lru_index = j;
+                int victim = -1, oldest = -1;
+                int limit = frames < WSCLOCK_SCAN ? frames : WSCLOCK_SCAN;
+                for (int scanned = 0; scanned < limit && victim == -1; scanned++, hand = (hand + 1) % frames) {
+                    if (referenced[hand]) {
+                        referenced[hand] = 0;
+                    } else if (now - last_use[hand] > window) {
+                        victim = hand;
+                    } else if (oldest == -1 || last_use[hand] < last_use[oldest]) {
+                        oldest = hand;
                     }
                 }
-
-                // Replace the LRU page
-                memory[lru_index] = page;
-                last_used[lru_index] = ++timer;
+                // Nothing outside the window: oldest unreferenced frame, else the one under the hand
+                if (victim == -1) victim = oldest != -1 ? oldest : hand;
+                f = victim;
+                pm_del(&map, memory[f]);
             }
+            memory[f] = page;
+            pm_put(&map, page, f);
+        }
+        referenced[f] = 1;
+        last_use[f] = now;
+    }
+    pm_free(&map);
+    free(memory);
+    free(last_use);
+    free(referenced);
+    return page_faults;
+}
+
+// Pure working-set policy: memory is not fixed, every page outside the window
+// is dropped. Reports faults and the mean working-set size.
+static long working_set(const Trace *t, long window, double *mean_size) {
+    long page_faults = 0, size = 0;
+    double total = 0;
+    PageMap last; // Page -> time of last reference
+    pm_init(&last, t->max_page, 1024);
+    const uint32_t *refs = opt_refs;
+
+    for (long now = 0; now < t->count; now++) {
+        // The reference that falls out of the window drops its page unless reused since
+        long old = now - window - 1;
+        if (old >= 0 && pm_get(&last, refs[old]) == old) size--;
+        long prev = pm_get(&last, refs[now]);
+        if (prev == -1 || now - prev > window) {
+            page_faults++;
+            size++;
         }
+        pm_put(&last, refs[now], now);
+        total += size;
     }
+    pm_free(&last);
+    *mean_size = t->count ? total / t->count : 0.0;
     return page_faults;
 }
 
+// --- Parallel sweep: every (policy, frame count) pair is an independent job ---
+// Workers start with a contiguous slice of the job list and pop from its
+// back; an idle worker steals from the front of another worker's slice.
+// Results go to per-worker buffers and are merged by job index, so the
+// output is identical to a serial run for any thread count.
+typedef long (*SimFn)(int frames, const Trace *t);
 
-int main() {
-    srand(time(NULL));
+static const struct { const char *name; SimFn fn; } policies[] = {
+    {"FIFO", fifo},
+    {"LRU", lru},
+    {"OPT", opt},
+    {"WSClock", wsclock},
+};
+#define NUM_POLICIES (int)(sizeof(policies) / sizeof(policies[0]))
 
-    // Generate random page-reference string
-    int ref_string[MAX_PAGES];
-    printf("Generated Page Reference String (%d items): ", MAX_PAGES);
-    for (int i = 0; i < MAX_PAGES; i++) {
-        ref_string[i] = rand() % PAGE_RANGE;
-        printf("%d ", ref_string[i]);
+typedef struct {
+    pthread_mutex_t lock;
+    long top, bottom;        // Jobs [top, bottom) not yet taken
+    long done;               // Entries in the result buffer
+    long *job, *faults;      // Per-worker result buffer
+    long steals;
+} SweepWorker;
+
+typedef struct {
+    const Trace *trace;
+    int min_frames, step;
+    int threads;
+    SweepWorker *workers;
+    int id;
+} SweepArg;
+
+static long sweep_take(SweepWorker *w, int own) {
+    long job = -1;
+    pthread_mutex_lock(&w->lock);
+    if (w->top < w->bottom) job = own ? --w->bottom : w->top++;
+    pthread_mutex_unlock(&w->lock);
+    return job;
+}
+
+static void *sweep_worker(void *p) {
+    SweepArg *a = p;
+    SweepWorker *me = &a->workers[a->id];
+    for (;;) {
+        long job = sweep_take(me, 1);
+        for (int v = 1; job == -1 && v < a->threads; v++) {
+            job = sweep_take(&a->workers[(a->id + v) % a->threads], 0);
+            if (job != -1) me->steals++;
+        }
+        if (job == -1) break; // Nothing left anywhere (jobs are never added)
+        int frames = a->min_frames + (int)(job / NUM_POLICIES) * a->step;
+        me->job[me->done] = job;
+        me->faults[me->done++] = policies[job % NUM_POLICIES].fn(frames, a->trace);
     }
-    printf("\n\n");
+    return NULL;
+}
 
-    printf("--- Page Fault Comparison ---\n");
-    printf("+------------+------------+------------+\n");
-    printf("| Frame Size | FIFO Faults| LRU Faults |\n");
-    printf("+------------+------------+------------+\n");
-    
-    // Simulate for frame sizes 1 to 7
-    for (int frames = MIN_FRAMES; frames <= MAX_FRAMES; frames++) {
-        int fifo_faults = fifo(frames, ref_string, MAX_PAGES);
-        int lru_faults = lru(frames, ref_string, MAX_PAGES);
+// Fill faults[job] for job = size index * NUM_POLICIES + policy; returns steals
+static long sweep(const Trace *t, int min_frames, int step, long jobs, int threads, long *faults) {
+    if (threads > jobs) threads = (int)jobs;
+    if (threads <= 1) {
+        for (long j = 0; j < jobs; j++) {
+            faults[j] = policies[j % NUM_POLICIES].fn(min_frames + (int)(j / NUM_POLICIES) * step, t);
+        }
+        return 0;
+    }
+    SweepWorker *workers = calloc(threads, sizeof(SweepWorker));
+    SweepArg *args = malloc(threads * sizeof(SweepArg));
+    pthread_t *tids = malloc(threads * sizeof(pthread_t));
+    for (int i = 0; i < threads; i++) {
+        pthread_mutex_init(&workers[i].lock, NULL);
+        workers[i].top = jobs * i / threads;
+        workers[i].bottom = jobs * (i + 1) / threads;
+        workers[i].job = malloc(jobs * sizeof(long));
+        workers[i].faults = malloc(jobs * sizeof(long));
+        args[i] = (SweepArg){t, min_frames, step, threads, workers, i};
+    }
+    // Every queue exists before any worker can steal from it, and none is
+    // torn down until all workers are done
+    for (int i = 0; i < threads; i++) pthread_create(&tids[i], NULL, sweep_worker, &args[i]);
+    for (int i = 0; i < threads; i++) pthread_join(tids[i], NULL);
+    long steals = 0;
+    for (int i = 0; i < threads; i++) {
+        for (long k = 0; k < workers[i].done; k++) faults[workers[i].job[k]] = workers[i].faults[k];
+        steals += workers[i].steals;
+        pthread_mutex_destroy(&workers[i].lock);
+        free(workers[i].job);
+        free(workers[i].faults);
+    }
+    free(workers);
+    free(args);
+    free(tids);
+    return steals;
+}
+
+// --- Mattson stack distances: LRU faults for every frame count in one pass ---
+// LRU is a stack algorithm: a reference hits with f frames exactly when its
+// stack distance (distinct pages touched since its previous use, itself
+// included) is <= f. Every position in time holds a mark while it is the
+// latest use of its page; a Fenwick tree counts the marks after a page's
+// previous use in O(log n). Positions are renumbered when the window fills,
+// so the tree stays within twice the distinct pages rather than the trace.
+typedef struct {
+    long refs;
+    long cold;               // First touches: faults at every size
+    long distinct;
+    long *hist;              // hist[d]: re-references at stack distance d
+    long *faults;            // faults[f]: LRU faults with f frames, f = 0..distinct
+} StackProfile;
+
+static void bit_add(int *bit, long n, long i, int v) {
+    for (i++; i <= n; i += i & -i) bit[i] += v;
+}
+
+// Marks at positions 0..i
+static long bit_prefix(const int *bit, long i) {
+    long sum = 0;
+    for (i++; i > 0; i -= i & -i) sum += bit[i];
+    return sum;
+}
+
+static void stack_profile(const Trace *t, StackProfile *sp) {
+    long cap = 1024, now = 0, live = 0, hist_cap = 1024;
+    int *bit = calloc(cap + 1, sizeof(int));
+    unsigned long *owner = malloc(cap * sizeof(unsigned long));
+    PageMap last; // Page -> position of its latest use
+    pm_init(&last, t->max_page, 1024);
+    memset(sp, 0, sizeof(*sp));
+    sp->hist = calloc(hist_cap, sizeof(long));
 
-        printf("| %10d | %10d | %10d |\n", frames, fifo_faults, lru_faults);
+    TraceCursor c = trace_cursor(t);
+    unsigned long page;
+    while (trace_next(&c, &page)) {
+        sp->refs++;
+        if (now == cap) {
+            // Window full: pack the live marks to the front, growing if they fill half
+            long k = 0;
+            for (long i = 0; i < now; i++) {
+                if (pm_get(&last, owner[i]) == i) {
+                    owner[k] = owner[i];
+                    pm_put(&last, owner[k], k);
+                    k++;
+                }
+            }
+            if (2 * k > cap) {
+                cap *= 2;
+                owner = realloc(owner, cap * sizeof(unsigned long));
+                bit = realloc(bit, (cap + 1) * sizeof(int));
+            }
+            memset(bit, 0, (cap + 1) * sizeof(int));
+            for (long i = 1; i <= cap; i++) {
+                bit[i] += i <= k;
+                long j = i + (i & -i);
+                if (j <= cap) bit[j] += bit[i];
+            }
+            now = k;
+        }
+        int p = pm_get(&last, page);
+        if (p != -1) {
+            long d = live - bit_prefix(bit, p) + 1;
+            sp->hist[d]++;
+            bit_add(bit, cap, p, -1);
+            live--;
+        } else {
+            sp->cold++;
+            if (++sp->distinct >= hist_cap) {
+                sp->hist = realloc(sp->hist, 2 * hist_cap * sizeof(long));
+                memset(sp->hist + hist_cap, 0, hist_cap * sizeof(long));
+                hist_cap *= 2;
+            }
+        }
+
+        bit_add(bit, cap, now, 1);
+        owner[now] = page;
+        pm_put(&last, page, now);
+        now++;
+        live++;
     }
+
+    // faults[f] = cold misses + re-references deeper than f
+    sp->faults = malloc((sp->distinct + 1) * sizeof(long));
+    sp->faults[sp->distinct] = sp->cold;
+    for (long f = sp->distinct; f > 0; f--) sp->faults[f - 1] = sp->faults[f] + sp->hist[f];
+
+    pm_free(&last);
+    free(bit);
+    free(owner);
+}
+
+static long stack_faults(const StackProfile *sp, long frames) {
+    return sp->faults[frames < sp->distinct ? frames : sp->distinct];
+}
+
+// --- Benchmark: fixed-seed traces from each workload, one CSV row per policy and size ---
+#define BENCH_PAGES 65536
+#define BENCH_FRAMES 1024
+#define BENCH_RUNS 3
+
+static double now_sec(void);
+
+static void bench_kernels(void) {
+    static const long sizes[] = {10000, 100000, 1000000};
+    static const struct { const char *name, *spec; } loads[] = {
+        {"uniform", "uniform"},
+        {"zipf", "zipf:0.99"},
+        {"ws", "ws:768,100000"},     // Working set fits in the frames between shifts
+        {"loop", "loop:1536"},       // Loop just larger than the frames
+    };
+    int nsizes = sizeof(sizes) / sizeof(sizes[0]);
+    uint32_t *refs = malloc(sizes[nsizes - 1] * sizeof(uint32_t));
+    printf("suite,case,size,metric,value\n");
+    for (size_t l = 0; l < sizeof(loads) / sizeof(loads[0]); l++) {
+        Workload wl;
+        Rng rng;
+        workload_open(&wl, loads[l].spec, BENCH_PAGES);
+        rng_seed(&rng, 1, 0);
+        workload_fill(&wl, &rng, refs, sizes[nsizes - 1]);
+        for (int s = 0; s < nsizes; s++) {
+            Trace t;
+            trace_from_array(&t, refs, sizes[s]);
+            for (int p = 0; p < NUM_POLICIES; p++) {
+                if (policies[p].fn == opt) continue;     // Needs the next-use prepass, not a replay kernel
+                double best = 0;
+                long faults = 0;
+                for (int r = 0; r < BENCH_RUNS; r++) {
+                    double t0 = now_sec();
+                    faults = policies[p].fn(BENCH_FRAMES, &t);
+                    double elapsed = now_sec() - t0;
+                    if (r == 0 || elapsed < best) best = elapsed;
+                }
+                printf("pagereplace,%s/%s,%ld,ns_per_ref,%.2f\n", policies[p].name, loads[l].name, sizes[s],
+                       best * 1e9 / sizes[s]);
+                printf("pagereplace,%s/%s,%ld,faults,%ld\n", policies[p].name, loads[l].name, sizes[s], faults);
+            }
+        }
+    }
+    free(refs);
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-t trace] [-c out.bin] [-g workload] [-n refs] [-p pages] [-s seed]\n"
+                    "          [-f lo[-hi[:step]]] [-w window] [-j threads] [-m] [-b]\n"
+                    "  -t  replay a text or binary page trace instead of a generated string\n"
+                    "  -c  convert the trace (or the generated string) to the binary format and exit\n"
+                    "  -g  generated pattern: uniform, zipf[:s], ws[:size[,phase]], scan, loop[:len] (default uniform)\n"
+                    "  -n  generated references (default %d)\n"
+                    "  -p  generated page range (default %d)\n"
+                    "  -s  seed for the generated string (default: time; printed so the run can be repeated)\n"
+                    "  -w  working-set window in references (default 4 x frames for WSClock)\n"
+                    "  -j  simulate the sweep on this many threads (0 = all CPUs, default 1)\n"
+                    "  -m  LRU miss-ratio curve for every frame count from one stack-distance pass\n"
+                    "  -b  benchmark the replay kernels on fixed traces of each workload, CSV output\n"
+                    "  -f  frame counts to compare (default %d-%d)\n", prog, MAX_PAGES, PAGE_RANGE, MIN_FRAMES, MAX_FRAMES);
+    exit(1);
+}
+
+static void print_rule(void) {
+    printf("+------------+");
+    for (int p = 0; p < NUM_POLICIES; p++) printf("----------------+");
+    printf("\n");
+}
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char *argv[]) {
+    const char *trace_path = NULL, *convert_path = NULL;
+    int min_frames = MIN_FRAMES, max_frames = MAX_FRAMES, step = 1;
+    int mrc = 0, threads = 1;
+    const char *spec = "uniform";
+    long length = MAX_PAGES;
+    unsigned long pages = PAGE_RANGE;
+    uint64_t seed = (uint64_t)time(NULL);
+    int opt;
+    while ((opt = getopt(argc, argv, "t:c:g:n:p:s:f:w:j:mb")) != -1) {
+        switch (opt) {
+        case 'g': spec = optarg; break;
+        case 'n': length = atol(optarg); break;
+        case 'p': pages = strtoul(optarg, NULL, 10); break;
+        case 's': seed = strtoull(optarg, NULL, 10); break;
+        case 'w': ws_window = atol(optarg); break;
+        case 'j': threads = atoi(optarg); break;
+        case 'm': mrc = 1; break;
+        case 'b': bench_kernels(); return 0;
+        case 't': trace_path = optarg; break;
+        case 'c': convert_path = optarg; break;
+        case 'f':
+            if (sscanf(optarg, "%d-%d:%d", &min_frames, &max_frames, &step) < 2) max_frames = min_frames;
+            break;
+        default: usage(argv[0]);
+        }
+    }
+    if (min_frames < 1 || max_frames < min_frames || step < 1 || threads < 0 || length < 1 || pages < 1) {
+        usage(argv[0]);
+    }
+    if (threads == 0) threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+
+    Trace trace;
+    uint32_t *ref_string = NULL;
+    if (trace_path) {
+        if (trace_open(&trace, trace_path) == -1) return 1;
+        printf("Trace %s: %ld references, pages 0-%lu\n\n", trace_path, trace.count, trace.max_page);
+    } else {
+        Workload wl;
+        Rng rng;
+        if (workload_open(&wl, spec, pages) == -1) return 1;
+        rng_seed(&rng, seed, 0);
+        ref_string = malloc(length * sizeof(uint32_t));
+        workload_fill(&wl, &rng, ref_string, length);
+        workload_close(&wl);
+
+        // Print the string when it is short enough to read
+        printf("Generated Page Reference String (%ld items, %s over %lu pages, seed %llu)", length, spec, pages,
+               (unsigned long long)seed);
+        if (length <= MAX_PAGES) {
+            printf(": ");
+            for (long i = 0; i < length; i++) printf("%u ", ref_string[i]);
+        }
+        printf("\n\n");
+        trace_from_array(&trace, ref_string, length);
+    }
+    if (convert_path) {
+        int rc = trace_write_binary(&trace, convert_path);
+        if (rc == 0) printf("Wrote binary trace %s\n", convert_path);
+        if (trace_path) trace_close(&trace);
+        free(ref_string);
+        return rc == 0 ? 0 : 1;
+    }
+
+    if (mrc) {
+        double t0 = now_sec();
+        StackProfile sp;
+        stack_profile(&trace, &sp);
+        double elapsed = now_sec() - t0;
+
+        printf("--- LRU Miss-Ratio Curve (stack distance) ---\n");
+        printf("+------------+------------+------------+\n");
+        printf("| Frame Size | LRU Faults | Miss Ratio |\n");
+        printf("+------------+------------+------------+\n");
+        for (int frames = min_frames; frames <= max_frames; frames += step) {
+            long faults = stack_faults(&sp, frames);
+            printf("| %10d | %10ld | %10.4f |\n", frames, faults, sp.refs ? (double)faults / sp.refs : 0.0);
+        }
+        printf("+------------+------------+------------+\n");
+        printf("One pass over %ld references (%ld distinct pages) in %.2f s; faults stay at %ld from %ld frames up\n",
+               sp.refs, sp.distinct, elapsed, sp.cold, sp.distinct);
+        free(sp.hist);
+        free(sp.faults);
+        if (trace_path) trace_close(&trace);
+        free(ref_string);
+        return 0;
+    }
+
+    // Simulate every policy for each frame size (1 to 7 by default)
+    int sizes = (max_frames - min_frames) / step + 1;
+    long jobs = (long)sizes * NUM_POLICIES;
+    long *faults = malloc(jobs * sizeof(long));
+    double t0 = now_sec();
+    opt_prepare(&trace);
+    long steals = sweep(&trace, min_frames, step, jobs, threads, faults);
+    double elapsed = now_sec() - t0;
+
+    printf("--- Page Fault Comparison ---\n");
+    print_rule();
+    printf("| Frame Size |");
+    for (int p = 0; p < NUM_POLICIES; p++) printf("%8s Faults |", policies[p].name);
+    printf("\n");
+    print_rule();
+    for (int i = 0; i < sizes; i++) {
+        printf("| %10d |", min_frames + i * step);
+        for (int p = 0; p < NUM_POLICIES; p++) printf(" %14ld |", faults[(long)i * NUM_POLICIES + p]);
+        printf("\n");
+    }
+    print_rule();
+    if (trace_path || length > MAX_PAGES) {
+        printf("Replayed %ld references in %.2f s (%.1f M refs/s) on %d thread(s), %ld jobs stolen\n",
+               jobs * trace.count, elapsed, elapsed > 0 ? jobs * trace.count / elapsed / 1e6 : 0.0,
+               threads, steals);
+    }
+    if (ws_window > 0) {
+        double mean_size;
+        long ws_faults = working_set(&trace, ws_window, &mean_size);
+        printf("Working set (window %ld): %ld faults, %.1f pages resident on average\n",
+               ws_window, ws_faults, mean_size);
+    }
+    printf("Note: LRU usually results in fewer page faults than FIFO; OPT is the lower bound for any policy.\n");
     
-    printf("+------------+------------+------------+\n");
-    printf("Note: LRU usually results in fewer page faults than FIFO.\n");
-    
+    free(faults);
+    free(opt_next_use);
+    free(opt_owned);
+    if (trace_path) trace_close(&trace);
+    free(ref_string);
     return 0;
-}
\ No newline at end of file
+}
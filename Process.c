@@ -1,5 +1,8 @@
 // Process.c
 #include "common.h"
+#include "transport.h"
+#include "stats.h"
+#include "workload.h"
 
 int main(int argc, char *argv[]) {
     if (argc < 2) {
@@ -8,42 +11,86 @@ int main(int argc, char *argv[]) {
     }
     int my_pid = atoi(argv[1]);
     
-    int msg_id = msgget(MSG_QUEUE_KEY, 0666);
-    if (msg_id == -1) { perror("msgget Process"); exit(1); }
+    Transport tp;
+    if (transport_attach(&tp) == -1) { perror("transport Process"); exit(1); }
+    SimConfig *cfg_shm = (SimConfig *)shmat(shmget(SHM_CONFIG_KEY, 0, 0666), NULL, 0);
+    if (cfg_shm == (void *)-1) { perror("shmat config Process"); exit(1); }
+    if (stats_attach() == -1) { perror("shmat stats Process"); exit(1); }
+    const int len = cfg_shm->reference_string_len;
     
-    // Seed random generation uniquely for each process
-    srand(time(NULL) * my_pid + getpid()); 
+    // One random stream per process (SIM_SEED makes runs repeatable)
+    const char *seed = env_str("SIM_SEED", NULL);
+    Rng rng;
+    rng_seed(&rng, seed ? strtoull(seed, NULL, 10) : (uint64_t)time(NULL) * my_pid + getpid(), my_pid);
 
-    // Generate a fixed page-reference string for this process
-    int reference_string[REFERENCE_STRING_LEN];
-    for (int i = 0; i < REFERENCE_STRING_LEN; i++) {
-        [cite_start]// Generate page numbers from 0 to 9 [cite: 36]
-        reference_string[i] = rand() % NUM_PAGES; 
+    // Generate a fixed page-reference string for this process; with a trace each process replays its own slice
+    const char *spec = env_str("SIM_WORKLOAD", "uniform");
+    Workload wl;
+    if (workload_open(&wl, spec, cfg_shm->num_pages) == -1) exit(1);
+    workload_seek(&wl, (unsigned long)my_pid * len);
+    int *reference_string = malloc(len * sizeof(int));
+    for (int i = 0; i < len; i++) {
+        reference_string[i] = workload_next(&wl, &rng);
+    }
+    workload_close(&wl);
+    int write_pct = atoi(env_str("SIM_WRITE_PCT", "0"));
+    for (int i = 0; write_pct > 0 && i < len; i++) {
+        if ((int)rng_below(&rng, 100) < write_pct) reference_string[i] |= REF_WRITE;
     }
     
-    printf("Process %d started. Reference string generated.\n", my_pid);
+    event_log("Process %d started. Reference string generated (%s).\n", my_pid, spec);
+
+    // References per request (SIM_BATCH) and simulated execution time per dispatch
+    int batch = atoi(env_str("SIM_BATCH", "1"));
+    if (batch < 1) batch = 1;
+    if (batch > BATCH_MAX) batch = BATCH_MAX;
+    int think_us = atoi(env_str("PROC_THINK_US", "100"));
 
-    // Execution loop
-    for (int i = 0; i < REFERENCE_STRING_LEN; i++) {
-        // 1. Wait for 'Ready to Run' signal from Scheduler
+    // Execution loop: every dispatch submits references starting at i, one more dispatch reports completion
+    int i = 0;
+    while (1) {
+        // 1. Wait for 'Ready to Run' signal from the Scheduler, or from the MMU after a hit within the quantum
         Message cmd;
-        if (msgrcv(msg_id, &cmd, sizeof(Message) - sizeof(long), MT_SCHEDULER_CMD, 0) == -1) {
+        long wait_start = stats_now_ns();
+        if (recv_command(&tp, my_pid, &cmd) == -1) {
             break; // Queue removed, simulation finished
         }
-        if (cmd.sender_pid != my_pid || cmd.status != 4) {
-            // Not my command, re-queue and continue
-            msgsnd(msg_id, &cmd, sizeof(Message) - sizeof(long), 0);
-            continue;
+        stats_add(&sim_stats->proc_wait_ns, stats_now_ns() - wait_start);
+        if (cmd.status == 3) {
+            event_log("Process %d terminated by the MMU.\n", my_pid);
+            break; // Illegal reference or page table exhausted; the MMU already counted it
         }
+        i += cmd.count; // References the MMU resolved during the previous dispatch
+
+        if (i >= len) {
+            event_log("Process %d finished.\n", my_pid);
 
-        // 2. Send Page Request to MMU
+            // 4. Notify MMU/Scheduler of completion
+            Message request;
+            request.sender_pid = my_pid;
+            request.page_number = -1; // Sentinel
+            request.status = 3; // Finished
+            request.slice = cmd.page_number;
+            send_request(&tp, &request);
+            break;
+        }
+
+        // 2. Send Page Request to MMU (or the next run of references in batched mode)
         Message request;
-        request.mtype = MT_PROCESS_REQUEST;
         request.sender_pid = my_pid;
         request.page_number = reference_string[i];
         request.status = 0; // Request
+        request.slice = cmd.page_number; // Quantum left: the MMU lets hits within it run on
+        if (batch > 1) {
+            request.status = 5; // Batch: MMU stops at the first fault
+            request.count = len - i < batch ? len - i : batch;
+            if (cmd.page_number > 0 && request.count > cmd.page_number) {
+                request.count = cmd.page_number; // Stay within the scheduler's quantum
+            }
+            memcpy(request.pages, &reference_string[i], request.count * sizeof(int));
+        }
         
-        if (msgsnd(msg_id, &request, sizeof(Message) - sizeof(long), 0) == -1) {
+        if (send_request(&tp, &request) == -1) {
             perror("msgsnd Process request");
             break;
         }
@@ -51,18 +98,11 @@ int main(int argc, char *argv[]) {
         // 3. Process is now waiting for MMU/Scheduler to resolve the request (Handled by Scheduler)
         
         // Simulate instruction execution time
-        usleep(100); 
+        if (think_us > 0) usleep(think_us); 
     }
     
-    [cite_start]printf("Process %d finished.\n", my_pid); [cite: 32]
-    
-    // 4. Notify MMU/Scheduler of completion
-    Message request;
-    request.mtype = MT_PROCESS_REQUEST;
-    request.sender_pid = my_pid;
-    request.page_number = -1; // Sentinel
-    request.status = 3; // Finished
-    msgsnd(msg_id, &request, sizeof(Message) - sizeof(long), 0);
-
+    free(reference_string);
+    shmdt(cfg_shm); shmdt(sim_stats);
+    transport_detach(&tp);
     return 0;
 }
\ No newline at end of file
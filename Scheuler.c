@@ -1,70 +1,194 @@
 // Scheduler.c
 #include "common.h"
+#include "transport.h"
+#include "scheduler.h"
+#include "stats.h"
 
-int main() {
-    int msg_id = msgget(MSG_QUEUE_KEY, 0666);
-    if (msg_id == -1) { perror("msgget Scheduler"); exit(1); }
+static long dispatches;
+
+// 1. Send 'Ready to Run' signal to pid
+static void dispatch(Transport *tp, int pid, int cpu, int resume, int quantum_left) {
+    Message cmd;
+    cmd.sender_pid = pid;
+    cmd.status = 4; // Ready_To_Run
+    cmd.count = resume;              // Where the process resumes
+    cmd.page_number = quantum_left;  // References left in its slice
+    dispatches++;
+    stats_add(&sim_stats->dispatches, 1);
+    stats_add(&sim_stats->procs[pid].dispatches, 1);
+    stats_event(EV_DISPATCH, pid, quantum_left, cpu, stats_now_ns());
+
+    if (send_command(tp, &cmd) == -1) {
+        perror("msgsnd Scheduler CMD");
+    }
+}
+
+int main(int argc, char *argv[]) {
+    Transport tp;
+    if (transport_attach(&tp) == -1) { perror("transport Scheduler"); exit(1); }
+    SimConfig *cfg_shm = (SimConfig *)shmat(shmget(SHM_CONFIG_KEY, 0, 0666), NULL, 0);
+    if (cfg_shm == (void *)-1) { perror("shmat config Scheduler"); exit(1); }
+    if (stats_attach() == -1) { perror("shmat stats Scheduler"); exit(1); }
+    const int nprocs = cfg_shm->num_processes;
+
+    // Scheduling policy: first argument, else SCHED_POLICY, else round robin
+    const char *policy_name = argc > 1 ? argv[1] : env_str("SCHED_POLICY", "rr");
+    const SchedPolicy *policy = sched_select(policy_name, nprocs);
+    if (policy == NULL) {
+        fprintf(stderr, "Scheduler: unknown scheduling policy '%s'\n", policy_name);
+        exit(1);
+    }
 
-    // Simple FCFS Ready Queue implementation
-    int ready_queue[NUM_PROCESSES];
-    int head = 0, tail = 0;
     int processes_finished = 0;
+    int *consumed = calloc(nprocs, sizeof(int)); // References resolved in each process's last dispatch
+    int *quantum_left = calloc(nprocs, sizeof(int));
+    int *used = calloc(nprocs, sizeof(int));     // References run in the current slice
+    int *cpu_of = calloc(nprocs, sizeof(int));
+    long switches = 0, expiries = 0;
+    long busy = 0, idle = 0, blocked_faults = 0; // Simulated time (us), summed over CPUs
+    long cleaner_writes = 0;                     // Background write-backs queued on the disks
+
+    // CPUs (SIM_CPUS): each runs one process at a time on its own simulated clock
+    int ncpus = atoi(env_str("SIM_CPUS", "1"));
+    if (ncpus < 1) ncpus = 1;
+    if (ncpus > nprocs) ncpus = nprocs;
+    int *cpu_pid = malloc(ncpus * sizeof(int));  // Running process, -1 if idle
+    int *cpu_last = malloc(ncpus * sizeof(int)); // Last process it ran
+    long *cpu_clock = calloc(ncpus, sizeof(long));
+    for (int c = 0; c < ncpus; c++) cpu_pid[c] = cpu_last[c] = -1;
+    int running = 0;
 
     // Initially, all processes are in the ready queue
-    for (int i = 0; i < NUM_PROCESSES; i++) {
-        ready_queue[tail++] = i;
-    }
+    for (int i = 0; i < nprocs; i++) rq_push(sp_level[i], i);
 
-    printf("Scheduler started. (FCFS)\n");
+    printf("Scheduler started. (%s, quantum %d, %d CPU%s, fault I/O %ld us on %d disk%s)\n",
+           policy->name, sp_quantum, ncpus, ncpus == 1 ? "" : "s",
+           io_latency, io_ndisks, io_ndisks == 1 ? "" : "s");
 
-    while (processes_finished < NUM_PROCESSES) {
-        if (head != tail) {
-            int current_pid = ready_queue[head];
-            
-            // 1. Send 'Ready to Run' signal to current_pid
-            Message cmd;
-            cmd.mtype = MT_SCHEDULER_CMD;
-            cmd.sender_pid = current_pid;
-            cmd.status = 4; // Ready_To_Run
+    while (processes_finished < nprocs) {
+        for (int c = 0; c < ncpus; c++) {
+            if (cpu_pid[c] != -1) continue;
+            // Reads that completed while this CPU ran its last process make their owners ready
+            int woken;
+            while ((woken = io_complete(cpu_clock[c])) != -1) rq_push(sp_level[woken], woken);
 
-            if (msgsnd(msg_id, &cmd, sizeof(Message) - sizeof(long), 0) == -1) {
-                perror("msgsnd Scheduler CMD");
+            // Pick the next process and give it a fresh slice
+            int pid = rq_pop();
+            if (pid == -1) continue;
+            cpu_pid[c] = pid;
+            cpu_of[pid] = c;
+            running++;
+            quantum_left[pid] = policy->quantum(pid);
+            used[pid] = 0;
+            if (pid != cpu_last[c]) {
+                switches++;
+                stats_add(&sim_stats->context_switches, 1);
             }
-            
-            // 2. Wait for Status Update from MMU (will carry the PID of the process that generated the event)
-            Message response;
-            if (msgrcv(msg_id, &response, sizeof(Message) - sizeof(long), MT_MMU_RESPONSE, 0) == -1) {
-                 // Check if the queue was removed by master (end of simulation)
-                 if (processes_finished < NUM_PROCESSES) {
-                    perror("msgrcv Scheduler response");
-                 }
-                 break;
+            cpu_last[c] = pid;
+            dispatch(&tp, pid, c, consumed[pid], quantum_left[pid]);
+        }
+        if (running == 0) {
+            if (io_next() == -1) break;
+            // Every live process waits on the disk: the CPUs idle until the next completion
+            for (int c = 0; c < ncpus; c++) {
+                if (cpu_clock[c] < io_next()) {
+                    idle += io_next() - cpu_clock[c];
+                    cpu_clock[c] = io_next();
+                }
             }
+            continue;
+        }
+        
+        // 2. Wait for Status Update from MMU (will carry the PID of the process that generated the event)
+        Message response;
+        long wait_start = stats_now_ns();
+        if (recv_response(&tp, &response) == -1) {
+             // Check if the queue was removed by master (end of simulation)
+             if (processes_finished < nprocs) {
+                perror("msgrcv Scheduler response");
+             }
+             break;
+        }
+        stats_add(&sim_stats->sched_wait_ns, stats_now_ns() - wait_start);
 
-            // The scheduler handles events based on the process that just ran (response.sender_pid)
-            int event_pid = response.sender_pid;
-
-            if (response.status == 1) { // Page Fault occurred
-                [cite_start]// Context switch: Put the process at the back of the queue (FCFS) [cite: 11]
-                ready_queue[tail % NUM_PROCESSES] = event_pid;
-                tail = (tail + 1) % NUM_PROCESSES;
-                head = (head + 1) % NUM_PROCESSES; // Move to the next process
-                printf("Scheduler: Process %d Page Fault. Context switch (-> %d).\n", 
-                       event_pid, ready_queue[head % NUM_PROCESSES]);
-            } else if (response.status == 2) { // Page Hit
-                // Continue execution. Process will send another request, or finish.
-                // Re-add to the front temporarily to allow more executions, or just keep FCFS strict:
-                ready_queue[tail % NUM_PROCESSES] = event_pid;
-                tail = (tail + 1) % NUM_PROCESSES;
-                head = (head + 1) % NUM_PROCESSES; // Move to the next process
-            } else if (response.status == 3) { // Process Finished
-                processes_finished++;
-                head = (head + 1) % NUM_PROCESSES; // Remove from ready queue
-                printf("Scheduler: Process %d finished. %d remaining.\n", event_pid, NUM_PROCESSES - processes_finished);
+        // The scheduler handles events based on the process that just ran (response.sender_pid)
+        int event_pid = response.sender_pid;
+        int c = cpu_of[event_pid];
+        // The slice ran every reference up to here, hits the MMU let through without a dispatch included
+        int ran = quantum_left[event_pid] - response.slice;
+        consumed[event_pid] = response.count;
+        used[event_pid] += ran;
+        quantum_left[event_pid] = response.slice;
+        cpu_clock[c] += ran * io_ref_cost;
+        busy += ran * io_ref_cost;
+        for (int d = 0; d < ncpus; d++) {
+            // Idle CPUs keep pace with the running ones
+            if (cpu_pid[d] == -1 && cpu_clock[d] < cpu_clock[c]) {
+                idle += cpu_clock[c] - cpu_clock[d];
+                cpu_clock[d] = cpu_clock[c];
             }
         }
+
+        policy->on_end(event_pid, used[event_pid], response.status == 1);
+        cpu_pid[c] = -1;
+        running--;
+        // Write-backs the MMU's cleaner issued since the last response take a disk from now
+        long bg = atomic_load(&sim_stats->cleaner_writebacks);
+        while (io_latency > 0 && cleaner_writes < bg) {
+            io_write(cpu_clock[c]);
+            cleaner_writes++;
+        }
+
+        if (response.status == 1 && io_latency > 0) { // Page Fault: block until the disk read completes
+            // Context switch: the next ready process runs during the read (and any write-back before it)
+            long done = io_submit(event_pid, cpu_clock[c], response.page_number);
+            blocked_faults++;
+            stats_event(EV_BLOCK, event_pid, (int)done, -1, stats_now_ns());
+            event_log("Scheduler: Process %d Page Fault. Blocked until %ld us, context switch (-> %d).\n",
+                      event_pid, done, rq_peek());
+        } else if (response.status == 1) { // Page Fault occurred
+            // Context switch: Put the process at the back of its queue
+            rq_push(sp_level[event_pid], event_pid);
+            event_log("Scheduler: Process %d Page Fault. Context switch (-> %d).\n", 
+                      event_pid, rq_peek());
+        } else if (response.status == 2) { // Quantum expired on a hit
+            expiries++;
+            rq_push(sp_level[event_pid], event_pid);
+        } else if (response.status == 3) { // Process Finished
+            processes_finished++; // Not re-queued
+            stats_event(EV_FINISH, event_pid, -1, -1, stats_now_ns());
+            event_log("Scheduler: Process %d finished. %d remaining.\n", event_pid, nprocs - processes_finished);
+        }
     }
 
+    long now = 0;
+    for (int c = 0; c < ncpus; c++) {
+        if (cpu_clock[c] > now) now = cpu_clock[c];
+    }
+    printf("Scheduler: %s: %ld dispatches, %ld context switches, %ld quantum expiries",
+           policy->name, dispatches, switches, expiries);
+    if (sp_demotions || sp_promotions || sp_boosts) {
+        printf(", %ld demotions, %ld promotions, %ld boosts", sp_demotions, sp_promotions, sp_boosts);
+    }
+    printf("\n");
+    if (io_latency > 0 && now > 0) {
+        // Synchronous faults would stall the CPU for the whole service time of each read
+        long serial = busy + blocked_faults * io_latency + io_write_time;
+        printf("Scheduler: simulated %ld us, CPU busy %ld us (%.1f%% utilization), idle %ld us, "
+               "%.0f us average fault wait\n",
+               now, busy, 100.0 * busy / ((double)now * ncpus), idle,
+               blocked_faults ? (double)io_wait_total / blocked_faults : 0.0);
+        if (io_writes > 0) {
+            printf("Scheduler: %ld dirty-page write-backs, %ld during faults, %ld us of disk time\n",
+                   io_writes, io_writes - cleaner_writes, io_write_time);
+        }
+        printf("Scheduler: one CPU with synchronous fault I/O would take %ld us: %.2fx throughput from overlap\n",
+               serial, (double)serial / now);
+    }
     printf("Scheduler terminating.\n");
+    free(consumed); free(quantum_left); free(used); free(cpu_of);
+    free(cpu_pid); free(cpu_last); free(cpu_clock);
+    shmdt(cfg_shm); shmdt(sim_stats);
+    transport_detach(&tp);
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,52 @@
+#!/bin/sh
+# bench.sh - repeatable benchmark suite, one CSV row per measurement:
+#   suite,case,size,metric,value
+# Run from the build directory (make bench). Results also go to $BENCH_OUT.
+# Every workload is seeded, so rows differ between runs only by timing.
+BENCH_OUT=${BENCH_OUT:-bench.csv}
+
+{
+echo "suite,case,size,metric,value"
+
+# Full pipeline: references per second through Process -> Scheduler -> MMU, and the fault rate.
+# The quantum matches the batch, since a batch never runs past it
+for workload in uniform zipf; do
+    for transport in msgq ring; do
+        for batch in 1 8; do
+            SIM_QUIET=1 SIM_SEED=1 PROC_THINK_US=0 SIM_WORKLOAD=$workload SIM_TRANSPORT=$transport SIM_BATCH=$batch \
+                SCHED_QUANTUM=$batch ./Master -p 4 -n 256 -f 64 -r 20000 |
+                sed -n -e "s/^Master: \([0-9]*\) references in .* (\([0-9]*\) refs\/s)$/pipeline,$transport-batch$batch\/$workload,\1,refs_per_sec,\2/p" \
+                       -e "s/^Master: summary: \([0-9]*\) references, .* faults (\([0-9.]*\)%).*/pipeline,$transport-batch$batch\/$workload,\1,fault_pct,\2/p"
+        done
+    done
+done
+
+# Dirty pages: write-back inside the fault vs the background cleaner (simulated fault wait)
+for low in 0 16; do
+    SIM_QUIET=1 SIM_SEED=1 PROC_THINK_US=0 SIM_WORKLOAD=zipf SIM_WRITE_PCT=30 SIM_FAULT_US=100 SIM_DISKS=8 \
+        SIM_REF_US=20 MMU_FREE_LOW=$low ./Master -p 8 -n 256 -f 256 -r 3000 |
+        sed -n -e "s/^Scheduler: simulated .*, \([0-9]*\) us average fault wait/writeback,free_low$low,24000,fault_wait_us,\1/p" \
+               -e "s/^Master: write-back: .*; \([0-9.]*\)% of faults found a free frame/writeback,free_low$low,24000,free_frame_pct,\1/p"
+done
+
+# Read-ahead on a sequential and a random workload: fault rate and prefetch accuracy
+for workload in scan uniform; do
+    for mode in off seq stride; do
+        SIM_QUIET=1 SIM_SEED=1 PROC_THINK_US=0 SIM_WORKLOAD=$workload MMU_PREFETCH=$mode MMU_PREFETCH_PAGES=8 \
+            ./Master -p 4 -n 256 -f 64 -r 5000 |
+            sed -n -e "s/^Master: summary: \([0-9]*\) references, .* faults (\([0-9.]*\)%).*/prefetch,$mode\/$workload,\1,fault_pct,\2/p" \
+                   -e "s/^Master: prefetch: .* (\([0-9.]*\)% accuracy).*/prefetch,$mode\/$workload,20000,accuracy_pct,\1/p"
+    done
+done
+
+# Replacement kernels and allocator strategies
+./PageReplace -b | tail -n +2
+for ops in 10000 100000; do
+    ./Fragmentation -c immediate -B $ops | tail -n +2
+done
+
+# Page-table entry layout
+./PTEBench | awk '
+    /^hit update/  { print "ptebench,hit_update,20000000,old_ns_per_ref," $5; print "ptebench,hit_update,20000000,new_ns_per_ref," $8 }
+    /^victim scan/ { print "ptebench,victim_scan,4096,old_ms_per_scan," $5; print "ptebench,victim_scan,4096,new_ms_per_scan," $8 }'
+} | tee "$BENCH_OUT"
@@ -10,55 +10,170 @@
 #include <sys/msg.h>
 #include <sys/wait.h>
 #include <string.h>
+#include <stddef.h>
 #include <time.h>
+#include <stdatomic.h>
 
-// --- Configuration ---
-[cite_start]#define NUM_PAGES 10             // Pages per process (0-9) [cite: 36]
-[cite_start]#define NUM_FRAMES 5             // Physical memory frames (1 to 7 possible, using 5) [cite: 37]
-#define NUM_PROCESSES 2          // Number of processes
-#define REFERENCE_STRING_LEN 15  // Length of the generated reference string
+// --- Configuration (defaults; Master -p/-n/-f/-r override them at runtime) ---
+#define DEFAULT_NUM_PAGES 10             // Pages per process (0-9)
+#define DEFAULT_NUM_FRAMES 5             // Physical memory frames (1 to 7 possible, using 5)
+#define DEFAULT_NUM_PROCESSES 2          // Number of processes
+#define DEFAULT_REFERENCE_STRING_LEN 15  // Length of the generated reference string
 
 // --- IPC Keys (Use ftok for real systems, using fixed keys for simulation simplicity) ---
+#define SHM_CONFIG_KEY 500
 #define SHM_PAGE_TABLE_KEY 1000
 #define SHM_FRAME_LIST_KEY 2000
 #define MSG_QUEUE_KEY 3000
 
 // --- Shared Data Structures ---
 
+// Simulation dimensions chosen by Master (shared variable). Every other
+// segment is sized from these and repeats the dimensions it depends on.
+typedef struct {
+    int num_processes;
+    int num_pages;            // Pages per process
+    int num_frames;
+    int reference_string_len;
+} SimConfig;
+
 // Global LRU counter (shared variable)
 #define SHM_LRU_COUNTER_KEY 4000
 typedef long LRUCounter;
 
-// Page Table Entry (PTE)
+// Frame-indexed LRU recency list (shared variable)
+#define SHM_LRU_LIST_KEY 5000
+
+// Page Table Entry (PTE), packed into one 64-bit word so a 64-byte cache
+// line holds 8 entries. The owning process is implied by the table row and
+// the full recency stamp lives in a per-frame array (see policy.h).
+#define PTE_AGE_BITS 28
+#define PTE_AGE_MASK ((1L << PTE_AGE_BITS) - 1)
 typedef struct {
-    int frame_number;
-    int present;      // 1 if page is in memory
-    long last_access; [cite_start]// For LRU: timestamp of last access [cite: 107]
-    int process_id;   // Owner Process ID
+    unsigned long frame_number : 32;
+    unsigned long present : 1;       // 1 if page is in memory
+    unsigned long referenced : 1;    // Reference bit, set on every access (Clock clears it)
+    unsigned long dirty : 1;         // Modified since it was loaded
+    unsigned long prefetched : 1;    // Read ahead and not referenced yet (see prefetch.h)
+    unsigned long age : PTE_AGE_BITS; // For LRU: low bits of the timestamp of last access
 } PTE;
 
-// Shared Memory Structure for the Page Table
-typedef struct {
-    PTE table[NUM_PROCESSES][NUM_PAGES];
-} PageTable;
+// Shared Memory Structure for the Page Table: sparse radix tree, see pagetable.h
 
-// Shared Memory Structure for the Free Frame List
+// Shared Memory Structure for the Free Frame List: a lock-free (Treiber)
+// stack linked through next[]. top packs a version tag above frame + 1, so a
+// pop that races with another pop and a re-push of the same frame fails its CAS.
 typedef struct {
-    int free_frame_count;
-    int free_frames[NUM_FRAMES]; // Acts as a stack for available frames
+    int num_frames;
+    _Atomic int free_frame_count;
+    _Atomic unsigned long top;       // tag << 32 | (frame + 1); frame + 1 == 0: empty
+    _Atomic int next[];              // Frame below each stacked frame, -1 at the bottom
 } FreeFrameList;
 
+#define FREE_FRAME_LIST_SIZE(frames) (sizeof(FreeFrameList) + (size_t)(frames) * sizeof(int))
+
+// Take a free frame, -1 if none
+static inline int ffl_pop(FreeFrameList *fl) {
+    unsigned long top = atomic_load(&fl->top);
+    for (;;) {
+        int frame = (int)(top & 0xffffffffUL) - 1;
+        if (frame < 0) return -1;
+        int below = atomic_load_explicit(&fl->next[frame], memory_order_relaxed);
+        unsigned long next_top = ((top >> 32) + 1) << 32 | (unsigned)(below + 1);
+        if (atomic_compare_exchange_weak(&fl->top, &top, next_top)) {
+            atomic_fetch_sub(&fl->free_frame_count, 1);
+            return frame;
+        }
+    }
+}
+
+static inline void ffl_push(FreeFrameList *fl, int frame) {
+    unsigned long top = atomic_load(&fl->top), next_top;
+    do {
+        atomic_store_explicit(&fl->next[frame], (int)(top & 0xffffffffUL) - 1, memory_order_relaxed);
+        next_top = ((top >> 32) + 1) << 32 | (unsigned)(frame + 1);
+    } while (!atomic_compare_exchange_weak(&fl->top, &top, next_top));
+    atomic_fetch_add(&fl->free_frame_count, 1);
+}
+
+// Shared Memory Structure for the LRU list: one node per physical frame.
+// Hits move the frame to the head, eviction pops the tail, both O(1).
+// owner_pid/owner_page map the frame back to its PTE.
+typedef struct {
+    int prev;         // Toward the head (more recent), -1 if none
+    int next;         // Toward the tail (less recent), -1 if none
+    int owner_pid;
+    int owner_page;
+} LRUNode;
+
+typedef struct {
+    int num_frames;
+    int head;         // Most recently used frame, -1 if empty
+    int tail;         // Least recently used frame (next victim), -1 if empty
+    LRUNode nodes[];
+} LRUList;
+
+#define LRU_LIST_SIZE(frames) (sizeof(LRUList) + (size_t)(frames) * sizeof(LRUNode))
+
+// --- Runtime switches (read from the environment, inherited from Master) ---
+// MMU_POLICY=lru|lru-scan|fifo|clock|second-chance|lfu|arc  Replacement policy (default lru)
+// SIM_BATCH=n        Process submits up to n references per request (1 = one at a time, default);
+//                    capped by the scheduler's quantum, whose default is SIM_BATCH (scheduler.h)
+// PROC_THINK_US=n    Simulated execution time per dispatch in microseconds (default 100)
+// SIM_WRITE_PCT=n    Percentage of references that write their page (default 0)
+// SIM_SEED=n         Fixed seed for the reference strings (default: time and pid)
+// SIM_WORKLOAD=spec  Reference pattern: uniform (default), zipf, ws, scan, loop, trace:path (workload.h)
+// TLB_ENTRIES, TLB_WAYS, TLB_MODE, TLB_REPLACE  MMU translation cache, see tlb.h
+// SCHED_POLICY, SCHED_QUANTUM, SCHED_PRIORITY, MLFQ_*  CPU scheduling, see scheduler.h
+// SIM_FAULT_US, SIM_DISKS, SIM_REF_US  Simulated fault I/O and CPU time, see scheduler.h
+// SIM_CPUS=n         Processes the Scheduler runs at once (default 1)
+// MMU_THREADS=n      MMU worker threads serving requests concurrently (default 1)
+// MMU_LOCK_STRIPES=n Page-table lock stripes for MMU_THREADS > 1, by process id (default 64)
+// MMU_FREE_LOW=n     Background cleaner keeps at least n frames free (default 0: faults evict inline)
+// MMU_CLEAN_BATCH=n  Most frames the cleaner evicts per policy lock hold (default 16)
+// MMU_PREFETCH, MMU_PREFETCH_PAGES, MMU_PREFETCH_ADAPT  Read-ahead on faults, see prefetch.h
+// SIM_QUIET, SIM_TRACE_EVENTS, SIM_TRACE_FILE  Per-event output and the event trace, see stats.h
+static inline const char *env_str(const char *name, const char *def) {
+    const char *v = getenv(name);
+    return (v && *v) ? v : def;
+}
+
+// Master: create a zeroed segment for 'key', removing one a previous run left
+// behind (it may have another size); returns the shm id or -1
+static inline int shm_create(key_t key, size_t size) {
+    int id = shmget(key, 0, 0666);
+    if (id != -1) shmctl(id, IPC_RMID, NULL);
+    return shmget(key, size, IPC_CREAT | IPC_EXCL | 0666);
+}
+
 // --- Message Queue Structure for IPC (Request/Response) ---
+#define BATCH_MAX 32      // Most references one batched request can carry
+
+// A reference is a page number, with REF_WRITE set when the access writes the page
+#define REF_WRITE (1 << 30)
+#define REF_PAGE(ref) ((ref) & ~REF_WRITE)
+
 typedef struct {
     long mtype;       // Used for routing messages (PID + 1 or other unique ID)
-    int sender_pid;   // Which Process sent the request (0 to NUM_PROCESSES-1)
-    int page_number;  // The requested page
-    int status;       // 0: Request, 1: Page Fault, 2: Hit, 3: Finished, 4: Ready_To_Run
+    int sender_pid;   // Which Process sent the request (0 to num_processes-1)
+    int page_number;  // The requested reference; Ready_To_Run: references left in the quantum;
+                      // Page Fault response: dirty pages written back before the read
+    int status;       // 0: Request, 1: Page Fault, 2: Hit, 3: Finished (to a Process: terminated), 4: Ready_To_Run, 5: Batch
+    int count;        // Batch: references in pages[]; MMU response / Ready_To_Run: references consumed
+    int slice;        // Request: references left in the quantum; MMU response: left after it
+    int pages[BATCH_MAX]; // Batch: the references (only the first count are transferred)
 } Message;
 
+// Bytes after mtype that a message actually carries (msgsnd size)
+#define MSG_PAYLOAD(m) (offsetof(Message, pages) - sizeof(long) + \
+                        ((m)->status == 5 ? (size_t)(m)->count * sizeof(int) : 0))
+
 // Define message types for clarity
 #define MT_PROCESS_REQUEST (long)1
 #define MT_MMU_RESPONSE    (long)2
-#define MT_SCHEDULER_CMD   (long)3
+#define MT_SCHEDULER_CMD   (long)100 // Base: process p only receives mtype MT_SCHEDULER_CMD + p
+
+// Per-process command channel, so a process only wakes for its own Ready_To_Run
+#define MT_SCHEDULER_CMD_FOR(pid) (MT_SCHEDULER_CMD + (long)(pid))
 
 #endif // COMMON_H
\ No newline at end of file
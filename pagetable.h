@@ -0,0 +1,135 @@
+// pagetable.h
+// Sparse multi-level (radix) page table in shared memory.
+//
+// Each process has a root; page numbers are split into PT_DIR_BITS-wide
+// directory indices above a PT_LEAF_BITS-wide leaf index. Directories and
+// leaves are carved on demand from a bump-allocated pool that follows the
+// header in the same segment, so memory grows with the pages that have
+// faulted, not with num_pages. Links are byte offsets from the segment
+// start (0 = not allocated), so every module can map the segment anywhere.
+// The pool and the leaf chain are updated atomically, so threads may grow the
+// trees of different processes at once; one process's tree needs its caller's lock.
+//
+//   num_pages <= 64        root is a leaf
+//   num_pages <= 32K       one directory level
+//   num_pages <= 16M       two directory levels, and so on
+#ifndef PAGETABLE_H
+#define PAGETABLE_H
+
+#include "common.h"
+
+#define PT_LEAF_BITS 6
+#define PT_DIR_BITS 9
+#define PT_LEAF_ENTRIES (1 << PT_LEAF_BITS)
+#define PT_DIR_ENTRIES (1 << PT_DIR_BITS)
+
+typedef unsigned long PTOffset;
+
+typedef struct {
+    PTOffset next_leaf;        // Chain of every allocated leaf (full-table scans)
+    int pid;                   // Process and first page covered by this leaf
+    int first_page;
+    PTE entries[PT_LEAF_ENTRIES];
+} PTLeaf;
+
+typedef struct {
+    PTOffset slots[PT_DIR_ENTRIES];
+} PTDir;
+
+// Shared Memory Structure for the Page Table
+typedef struct {
+    int num_processes;
+    int num_pages;
+    int levels;                // Directory levels above the leaves
+    size_t pool_size;          // Bytes in the segment, header included
+    size_t pool_used;          // Bump pointer (byte offset of the next free node)
+    long leaves, dirs;         // Nodes allocated so far
+    PTOffset first_leaf;
+    PTOffset roots[];          // num_processes roots, then the node pool
+} PageTable;
+
+static inline int pt_levels(int num_pages) {
+    int levels = 0;
+    for (long span = PT_LEAF_ENTRIES; span < num_pages; span <<= PT_DIR_BITS) levels++;
+    return levels;
+}
+
+// Segment size that can hold every node ever needed when each process
+// touches at most 'touched' distinct pages
+static inline size_t pt_segment_size(int procs, int pages, long touched) {
+    int levels = pt_levels(pages);
+    size_t size = sizeof(PageTable) + (size_t)procs * sizeof(PTOffset);
+    long span = PT_LEAF_ENTRIES;
+    long leaves = (pages + span - 1) / span;
+    size += (size_t)procs * (leaves < touched ? leaves : touched) * sizeof(PTLeaf);
+    for (int l = 1; l <= levels; l++) {
+        span <<= PT_DIR_BITS;
+        long dirs = (pages + span - 1) / span;
+        size += (size_t)procs * (dirs < touched ? dirs : touched) * sizeof(PTDir);
+    }
+    return size;
+}
+
+static inline void *pt_node(PageTable *pt, PTOffset off) {
+    return (char *)pt + off;
+}
+
+// Header initialisation; the pool itself must already be zero (fresh segment)
+static inline void pt_init(PageTable *pt, int procs, int pages, size_t segment_size) {
+    pt->num_processes = procs;
+    pt->num_pages = pages;
+    pt->levels = pt_levels(pages);
+    pt->pool_size = segment_size;
+    pt->pool_used = (sizeof(PageTable) + (size_t)procs * sizeof(PTOffset) + 7) & ~(size_t)7;
+    pt->leaves = pt->dirs = 0;
+    pt->first_leaf = 0;
+}
+
+static inline PTOffset pt_alloc(PageTable *pt, size_t size) {
+    size_t used = __atomic_load_n(&pt->pool_used, __ATOMIC_RELAXED);
+    do {
+        if (used + size > pt->pool_size) return 0;
+    } while (!__atomic_compare_exchange_n(&pt->pool_used, &used, used + size, 1,
+                                          __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+    return used;
+}
+
+// Read-only walk: NULL if the page's leaf was never allocated
+static inline PTE *pte_lookup(PageTable *pt, int pid, int page) {
+    PTOffset off = pt->roots[pid];
+    for (int l = pt->levels; l > 0 && off; l--) {
+        int idx = (page >> (PT_LEAF_BITS + (l - 1) * PT_DIR_BITS)) & (PT_DIR_ENTRIES - 1);
+        off = ((PTDir *)pt_node(pt, off))->slots[idx];
+    }
+    if (!off) return NULL;
+    return &((PTLeaf *)pt_node(pt, off))->entries[page & (PT_LEAF_ENTRIES - 1)];
+}
+
+// Walk that allocates missing directories and the leaf; NULL if the pool is exhausted
+static inline PTE *pte_at(PageTable *pt, int pid, int page) {
+    PTOffset *slot = &pt->roots[pid];
+    for (int l = pt->levels; ; l--) {
+        if (*slot == 0) {
+            if (l > 0) {
+                if ((*slot = pt_alloc(pt, sizeof(PTDir))) == 0) return NULL;
+                __atomic_fetch_add(&pt->dirs, 1, __ATOMIC_RELAXED);
+            } else {
+                if ((*slot = pt_alloc(pt, sizeof(PTLeaf))) == 0) return NULL;
+                PTLeaf *leaf = (PTLeaf *)pt_node(pt, *slot);
+                leaf->pid = pid;
+                leaf->first_page = page & ~(PT_LEAF_ENTRIES - 1);
+                leaf->next_leaf = __atomic_load_n(&pt->first_leaf, __ATOMIC_RELAXED);
+                while (!__atomic_compare_exchange_n(&pt->first_leaf, &leaf->next_leaf, *slot, 1,
+                                                    __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+                }
+                __atomic_fetch_add(&pt->leaves, 1, __ATOMIC_RELAXED);
+            }
+        }
+        if (l == 0) break;
+        int idx = (page >> (PT_LEAF_BITS + (l - 1) * PT_DIR_BITS)) & (PT_DIR_ENTRIES - 1);
+        slot = &((PTDir *)pt_node(pt, *slot))->slots[idx];
+    }
+    return &((PTLeaf *)pt_node(pt, *slot))->entries[page & (PT_LEAF_ENTRIES - 1)];
+}
+
+#endif // PAGETABLE_H
@@ -0,0 +1,381 @@
+// policy.h
+// Page replacement policies for the MMU. Selected at startup by name
+// (MMU_POLICY environment variable or the MMU's first argument).
+//
+// Contract with the fault handler:
+//   on_hit(frame)            resident page referenced again
+//   on_miss(pid, page)       fault on a non-resident page, before a frame is chosen
+//   victim()                 no free frame: pick a frame and detach it from the
+//                            policy's bookkeeping (its owner is still readable)
+//   on_load(frame, pid, page) page now resident in frame
+// Every policy is O(1) or amortized O(1) per call except "lru-scan", which is
+// the original page-table scan kept for comparison.
+//
+// With MMU worker threads every call runs under the MMU's policy lock, except
+// that on_hit == nop_hit lets hits skip the lock entirely. PTEs of other
+// processes are only touched between pol_pte_lock/pol_pte_unlock.
+#ifndef POLICY_H
+#define POLICY_H
+
+#include "common.h"
+#include "pagetable.h"
+
+typedef struct {
+    const char *name;
+    void (*on_hit)(int frame);
+    void (*on_miss)(int pid, int page);
+    int  (*victim)(void);
+    void (*on_load)(int frame, int pid, int page);
+} ReplacementPolicy;
+
+// --- Context shared by all policies (set by policy_select) ---
+static PageTable *pol_pt;
+static LRUList *pol_lru;
+static int pol_frames;                       // Physical frames (sizes all per-frame state)
+static long *pol_recency;                    // Last access stamp per frame (struct-of-arrays)
+static void (*pol_pte_lock)(int pid);        // Page-table lock of a process (threaded MMU only)
+static void (*pol_pte_unlock)(int pid);
+
+// --- Index-linked list over fixed arrays (private policy state) ---
+typedef struct { int head, tail, size; } IdxList;
+
+static void il_init(IdxList *l) { l->head = l->tail = -1; l->size = 0; }
+
+static void il_unlink(IdxList *l, int *prev, int *next, int i) {
+    if (prev[i] != -1) next[prev[i]] = next[i]; else l->head = next[i];
+    if (next[i] != -1) prev[next[i]] = prev[i]; else l->tail = prev[i];
+    prev[i] = next[i] = -1;
+    l->size--;
+}
+
+static void il_push_head(IdxList *l, int *prev, int *next, int i) {
+    prev[i] = -1;
+    next[i] = l->head;
+    if (l->head != -1) prev[l->head] = i; else l->tail = i;
+    l->head = i;
+    l->size++;
+}
+
+// --- Shared LRU list helpers (O(1) maintenance of the shared recency list) ---
+static void lru_unlink(LRUList *l, int frame) {
+    LRUNode *n = &l->nodes[frame];
+    if (n->prev != -1) l->nodes[n->prev].next = n->next; else l->head = n->next;
+    if (n->next != -1) l->nodes[n->next].prev = n->prev; else l->tail = n->prev;
+    n->prev = n->next = -1;
+}
+
+static void lru_push_head(LRUList *l, int frame) {
+    LRUNode *n = &l->nodes[frame];
+    n->prev = -1;
+    n->next = l->head;
+    if (l->head != -1) l->nodes[l->head].prev = frame; else l->tail = frame;
+    l->head = frame;
+}
+
+// Page hit: the frame becomes the most recently used one
+static void lru_touch(LRUList *l, int frame) {
+    if (l->head == frame) return;
+    lru_unlink(l, frame);
+    lru_push_head(l, frame);
+}
+
+static PTE *owner_pte(int frame) {
+    return pte_lookup(pol_pt, pol_lru->nodes[frame].owner_pid, pol_lru->nodes[frame].owner_page);
+}
+
+static void nop_hit(int frame) { (void)frame; }
+static void nop_miss(int pid, int page) { (void)pid; (void)page; }
+
+// --- LRU: recency list, evict the tail ---
+static void lru_on_hit(int frame) { lru_touch(pol_lru, frame); }
+static void lru_on_load(int frame, int pid, int page) { (void)pid; (void)page; lru_push_head(pol_lru, frame); }
+
+static int lru_victim(void) {
+    int frame = pol_lru->tail;
+    if (frame != -1) lru_unlink(pol_lru, frame);
+    return frame;
+}
+
+// --- LRU (scan): minimum last access search, kept for comparison ---
+// Scans the dense per-frame recency array (8 stamps per cache line) rather
+// than every PTE of every process.
+static int lru_scan_victim(void) {
+    int best = -1;
+    for (int f = 0; f < pol_frames; f++) {
+        if (pol_lru->nodes[f].owner_pid == -1) continue; // Free frame
+        if (best == -1 || __atomic_load_n(&pol_recency[f], __ATOMIC_RELAXED) <
+                          __atomic_load_n(&pol_recency[best], __ATOMIC_RELAXED)) best = f;
+    }
+    if (best != -1) lru_unlink(pol_lru, best);
+    return best;
+}
+
+// --- FIFO: load order only, hits do not reorder (nop_hit) ---
+
+// --- Clock (second chance): reference bit in the PTE, hand sweeps the frames ---
+static int clock_hand = 0;
+
+// Hits use nop_hit: the MMU sets PTE.referenced on every hit. Prefetched pages
+// are loaded with the bit clear, so the hand takes them first if they stay unused.
+static void clock_on_load(int frame, int pid, int page) { (void)frame; (void)pid; (void)page; }
+
+static int clock_victim(void) {
+    // At most two sweeps: the first clears every reference bit
+    for (int steps = 0; steps < 2 * pol_frames + 1; steps++) {
+        int frame = clock_hand;
+        clock_hand = (clock_hand + 1) % pol_frames;
+        if (pol_lru->nodes[frame].owner_pid == -1) continue; // Free frame, not a candidate
+        int owner = pol_lru->nodes[frame].owner_pid;
+        if (pol_pte_lock) pol_pte_lock(owner);
+        PTE *e = owner_pte(frame);
+        int referenced = e->referenced;
+        e->referenced = 0; // Second chance (the victim's bit is cleared on eviction anyway)
+        if (pol_pte_unlock) pol_pte_unlock(owner);
+        if (referenced) continue;
+        return frame;
+    }
+    return -1;
+}
+
+// --- LFU: frequency buckets in ascending order, LRU among equal counts ---
+typedef struct {
+    long freq;
+    int prev, next;   // Neighbouring buckets (lower / higher frequency)
+    IdxList items;    // Frames with this count, most recent at head
+} LFUBucket;
+
+static LFUBucket *lfu_buckets;    // pol_frames + 1 (one spare while moving a frame up)
+static int lfu_min = -1;          // Lowest-frequency bucket
+static int lfu_free = -1;         // Unused buckets, chained through next
+static int *lfu_bucket_of;
+static int *lfu_prev, *lfu_next;
+
+static void lfu_init(void) {
+    lfu_buckets = malloc((pol_frames + 1) * sizeof(LFUBucket));
+    lfu_bucket_of = malloc(pol_frames * sizeof(int));
+    lfu_prev = malloc(pol_frames * sizeof(int));
+    lfu_next = malloc(pol_frames * sizeof(int));
+    for (int i = 0; i <= pol_frames; i++) lfu_buckets[i].next = (i < pol_frames) ? i + 1 : -1;
+    lfu_free = 0;
+    lfu_min = -1;
+}
+
+// New bucket for freq, linked right after 'after' (-1: at the low end)
+static int lfu_new_bucket(long freq, int after) {
+    int b = lfu_free;
+    lfu_free = lfu_buckets[b].next;
+    lfu_buckets[b].freq = freq;
+    il_init(&lfu_buckets[b].items);
+    lfu_buckets[b].prev = after;
+    lfu_buckets[b].next = (after == -1) ? lfu_min : lfu_buckets[after].next;
+    if (lfu_buckets[b].next != -1) lfu_buckets[lfu_buckets[b].next].prev = b;
+    if (after == -1) lfu_min = b; else lfu_buckets[after].next = b;
+    return b;
+}
+
+static void lfu_remove(int frame) {
+    int b = lfu_bucket_of[frame];
+    il_unlink(&lfu_buckets[b].items, lfu_prev, lfu_next, frame);
+    if (lfu_buckets[b].items.size == 0) {
+        if (lfu_buckets[b].prev != -1) lfu_buckets[lfu_buckets[b].prev].next = lfu_buckets[b].next;
+        else lfu_min = lfu_buckets[b].next;
+        if (lfu_buckets[b].next != -1) lfu_buckets[lfu_buckets[b].next].prev = lfu_buckets[b].prev;
+        lfu_buckets[b].next = lfu_free;
+        lfu_free = b;
+    }
+}
+
+static void lfu_on_hit(int frame) {
+    int b = lfu_bucket_of[frame];
+    long freq = lfu_buckets[b].freq + 1;
+    int nb = lfu_buckets[b].next;
+    if (nb == -1 || lfu_buckets[nb].freq != freq) nb = lfu_new_bucket(freq, b);
+    lfu_remove(frame);
+    il_push_head(&lfu_buckets[nb].items, lfu_prev, lfu_next, frame);
+    lfu_bucket_of[frame] = nb;
+}
+
+static void lfu_on_load(int frame, int pid, int page) {
+    (void)pid; (void)page;
+    int b = (lfu_min != -1 && lfu_buckets[lfu_min].freq == 1) ? lfu_min : lfu_new_bucket(1, -1);
+    il_push_head(&lfu_buckets[b].items, lfu_prev, lfu_next, frame);
+    lfu_bucket_of[frame] = b;
+}
+
+static int lfu_victim(void) {
+    if (lfu_min == -1) return -1;
+    int frame = lfu_buckets[lfu_min].items.tail;
+    lfu_remove(frame);
+    return frame;
+}
+
+// --- ARC: T1 (seen once) / T2 (seen again) plus ghost directories B1 / B2 ---
+// Ghost entries remember evicted (pid, page) pairs; a small open-addressing
+// map finds the ghost slot of a faulting page.
+static IdxList arc_t[2], arc_b[2];
+static int arc_p = 0;                        // Target size of T1
+static int *arc_t_of;                        // Per frame
+static int *arc_prev, *arc_next;
+static int arc_ghosts;                       // Ghost slots: 2 * pol_frames
+static int *arc_gprev, *arc_gnext;
+static int *arc_gpid, *arc_gpage, *arc_b_of;
+static int arc_gfree = -1;                   // Unused ghost slots, chained through gnext
+static int arc_incoming = -1;                // Ghost list (0/1) the faulting page was found in
+static int arc_forget = 0;                   // T1 alone fills the cache: evict without a ghost
+static unsigned long *arc_map_key;           // (pid, page) key + 1, 0 = empty
+static int *arc_map_slot;
+static unsigned long arc_map_mask;
+
+static unsigned long arc_key(int pid, int page) {
+    return ((unsigned long)pid << 32 | (unsigned)page) + 1;
+}
+
+static unsigned long arc_hash(unsigned long k) {
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdUL;
+    k ^= k >> 33;
+    return k & arc_map_mask;
+}
+
+static unsigned long arc_map_find(unsigned long k) {
+    unsigned long i = arc_hash(k);
+    while (arc_map_key[i] != 0 && arc_map_key[i] != k) i = (i + 1) & arc_map_mask;
+    return i;
+}
+
+// Linear-probing delete with backward shift (no tombstones)
+static void arc_map_erase(unsigned long k) {
+    unsigned long i = arc_map_find(k);
+    if (arc_map_key[i] == 0) return;
+    for (unsigned long j = (i + 1) & arc_map_mask; arc_map_key[j] != 0; j = (j + 1) & arc_map_mask) {
+        unsigned long h = arc_hash(arc_map_key[j]);
+        if (((j - h) & arc_map_mask) >= ((j - i) & arc_map_mask)) {
+            arc_map_key[i] = arc_map_key[j];
+            arc_map_slot[i] = arc_map_slot[j];
+            i = j;
+        }
+    }
+    arc_map_key[i] = 0;
+}
+
+static void arc_init(void) {
+    arc_ghosts = 2 * pol_frames;
+    arc_t_of = malloc(pol_frames * sizeof(int));
+    arc_prev = malloc(pol_frames * sizeof(int));
+    arc_next = malloc(pol_frames * sizeof(int));
+    arc_gprev = malloc(arc_ghosts * sizeof(int));
+    arc_gnext = malloc(arc_ghosts * sizeof(int));
+    arc_gpid = malloc(arc_ghosts * sizeof(int));
+    arc_gpage = malloc(arc_ghosts * sizeof(int));
+    arc_b_of = malloc(arc_ghosts * sizeof(int));
+    for (int i = 0; i < 2; i++) { il_init(&arc_t[i]); il_init(&arc_b[i]); }
+    for (int i = 0; i < arc_ghosts; i++) arc_gnext[i] = (i + 1 < arc_ghosts) ? i + 1 : -1;
+    unsigned long cap = 16;
+    while (cap < 4UL * arc_ghosts) cap <<= 1;
+    arc_map_mask = cap - 1;
+    arc_map_key = calloc(cap, sizeof(unsigned long));
+    arc_map_slot = malloc(cap * sizeof(int));
+    arc_gfree = 0;
+}
+
+static void arc_drop_ghost(int g) {
+    il_unlink(&arc_b[arc_b_of[g]], arc_gprev, arc_gnext, g);
+    arc_map_erase(arc_key(arc_gpid[g], arc_gpage[g]));
+    arc_gnext[g] = arc_gfree;
+    arc_gfree = g;
+}
+
+static void arc_add_ghost(int list, int pid, int page) {
+    if (arc_gfree == -1) arc_drop_ghost(arc_b[list].size > 0 ? arc_b[list].tail : arc_b[1 - list].tail);
+    int g = arc_gfree;
+    arc_gfree = arc_gnext[g];
+    arc_gpid[g] = pid;
+    arc_gpage[g] = page;
+    arc_b_of[g] = list;
+    il_push_head(&arc_b[list], arc_gprev, arc_gnext, g);
+    unsigned long k = arc_key(pid, page), i = arc_map_find(k);
+    arc_map_key[i] = k;
+    arc_map_slot[i] = g;
+}
+
+static void arc_on_hit(int frame) {
+    il_unlink(&arc_t[arc_t_of[frame]], arc_prev, arc_next, frame);
+    il_push_head(&arc_t[1], arc_prev, arc_next, frame);
+    arc_t_of[frame] = 1;
+}
+
+static void arc_on_miss(int pid, int page) {
+    const int c = pol_frames;
+    unsigned long i = arc_map_find(arc_key(pid, page));
+    int g = arc_map_key[i] != 0 ? arc_map_slot[i] : -1;
+    arc_incoming = -1;
+    arc_forget = 0;
+    if (g >= 0) {
+        // Ghost hit: adapt the T1 target towards the list that would have kept the page
+        int b1 = arc_b[0].size, b2 = arc_b[1].size;
+        arc_incoming = arc_b_of[g];
+        if (arc_incoming == 0) arc_p += (b2 / b1 > 1) ? b2 / b1 : 1;
+        else arc_p -= (b1 / b2 > 1) ? b1 / b2 : 1;
+        if (arc_p > c) arc_p = c;
+        if (arc_p < 0) arc_p = 0;
+        arc_drop_ghost(g);
+        return;
+    }
+    // Brand-new page: keep |T1| + |B1| <= c and the whole directory <= 2c
+    if (arc_t[0].size + arc_b[0].size >= c) {
+        if (arc_b[0].size > 0) arc_drop_ghost(arc_b[0].tail);
+        else arc_forget = 1;
+    } else if (arc_t[0].size + arc_t[1].size + arc_b[0].size + arc_b[1].size >= 2 * c) {
+        if (arc_b[1].size > 0) arc_drop_ghost(arc_b[1].tail);
+    }
+}
+
+static int arc_victim(void) {
+    int from;
+    if (arc_t[0].size > 0 &&
+        (arc_t[0].size > arc_p || (arc_incoming == 1 && arc_t[0].size == arc_p) || arc_t[1].size == 0)) {
+        from = 0;
+    } else {
+        from = 1;
+    }
+    int frame = arc_t[from].tail;
+    if (frame == -1) return -1;
+    il_unlink(&arc_t[from], arc_prev, arc_next, frame);
+    if (!arc_forget) arc_add_ghost(from, pol_lru->nodes[frame].owner_pid, pol_lru->nodes[frame].owner_page);
+    arc_forget = 0;
+    return frame;
+}
+
+static void arc_on_load(int frame, int pid, int page) {
+    (void)pid; (void)page;
+    int list = (arc_incoming == -1) ? 0 : 1; // Ghost hits go straight to T2
+    il_push_head(&arc_t[list], arc_prev, arc_next, frame);
+    arc_t_of[frame] = list;
+    arc_incoming = -1;
+}
+
+static const ReplacementPolicy policies[] = {
+    { "lru",      lru_on_hit,   nop_miss,    lru_victim,      lru_on_load   },
+    { "lru-scan", lru_on_hit,   nop_miss,    lru_scan_victim, lru_on_load   },
+    { "fifo",     nop_hit,      nop_miss,    lru_victim,      lru_on_load   },
+    { "clock",    nop_hit,      nop_miss,    clock_victim,    clock_on_load },
+    { "lfu",      lfu_on_hit,   nop_miss,    lfu_victim,      lfu_on_load   },
+    { "arc",      arc_on_hit,   arc_on_miss, arc_victim,      arc_on_load   },
+};
+
+// Look up a policy by name ("second-chance" is an alias for "clock"); NULL if unknown
+static const ReplacementPolicy *policy_select(const char *name, PageTable *pt, LRUList *lru) {
+    if (strcmp(name, "second-chance") == 0) name = "clock";
+    pol_pt = pt;
+    pol_lru = lru;
+    pol_frames = lru->num_frames;
+    pol_recency = calloc(pol_frames, sizeof(long));
+    lfu_init();
+    arc_init();
+    for (size_t i = 0; i < sizeof(policies) / sizeof(policies[0]); i++) {
+        if (strcmp(policies[i].name, name) == 0) return &policies[i];
+    }
+    return NULL;
+}
+
+#endif // POLICY_H
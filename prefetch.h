@@ -0,0 +1,115 @@
+// prefetch.h
+// Read-ahead on page faults for the MMU.
+//
+// MMU_PREFETCH=off|seq|stride  (default off)
+//   seq      a fault on page p also loads p+1 .. p+window
+//   stride   a per-process detector watches every reference; once two consecutive
+//            references are the same distance d apart, a fault on p loads
+//            p+d .. p+window*d (sequential access is d = 1)
+// MMU_PREFETCH_PAGES=k    Largest window (default 4, at most PF_MAX_PAGES)
+// MMU_PREFETCH_ADAPT=0|1  Size each process's window from its prefetch hit rate
+//                         (default 1): start at 1, double while at least 3/4 of its
+//                         prefetched pages are referenced, halve when fewer than 1/4
+//                         are, down to 0, where one page is still tried every
+//                         PF_PROBE faults. With 0 the window is always k.
+//
+// Prefetched pages take free frames first, then the policy's victims (all chosen
+// before any prefetched page is loaded, so they cannot evict each other). They
+// join the policy like any loaded page but with PTE.referenced clear, and ride
+// on the fault's disk read, so the Scheduler charges nothing extra.
+// Read-ahead never allocates page-table leaves (Master sizes the pool for the
+// pages a run can reference), so it stops at the end of the faulting page's
+// leaf unless the next one already exists.
+// PTE.prefetched stays set until the first reference (a prefetch hit) or the
+// eviction (wasted); the adaptive window keeps the waste down.
+//
+// A process's state is only touched under its page-table stripe.
+#ifndef PREFETCH_H
+#define PREFETCH_H
+
+#include "common.h"
+
+#define PF_MAX_PAGES 64
+#define PF_ADAPT_EVERY 8      // Outcomes between window adjustments
+#define PF_PROBE 16
+
+enum { PF_OFF, PF_SEQ, PF_STRIDE };
+
+typedef struct {
+    int last_page;            // Last reference, -1 before the first
+    int stride;               // Distance between the last two references
+    int confirmed;            // The same stride twice in a row
+    int window;               // Pages to read ahead on the next fault
+    int useful, wasted;       // Outcomes since the last adjustment
+    int faults;               // Faults at window 0, for probing
+} PrefetchState;
+
+static int pf_mode = PF_OFF;
+static int pf_max, pf_adapt;
+static PrefetchState *pf_state;
+
+static const char *pf_name(void) {
+    return pf_mode == PF_SEQ ? "seq" : pf_mode == PF_STRIDE ? "stride" : "off";
+}
+
+// Returns -1 for an unknown mode
+static int pf_init(int nprocs) {
+    const char *mode = env_str("MMU_PREFETCH", "off");
+    if (strcmp(mode, "seq") == 0) pf_mode = PF_SEQ;
+    else if (strcmp(mode, "stride") == 0) pf_mode = PF_STRIDE;
+    else if (strcmp(mode, "off") != 0) return -1;
+    pf_max = atoi(env_str("MMU_PREFETCH_PAGES", "4"));
+    if (pf_max < 1) pf_max = 1;
+    if (pf_max > PF_MAX_PAGES) pf_max = PF_MAX_PAGES;
+    pf_adapt = atoi(env_str("MMU_PREFETCH_ADAPT", "1")) != 0;
+    pf_state = calloc(nprocs, sizeof(PrefetchState));
+    for (int i = 0; i < nprocs; i++) {
+        pf_state[i].last_page = -1;
+        pf_state[i].window = pf_adapt ? 1 : pf_max;
+    }
+    return 0;
+}
+
+// Every reference of pid, in order (stride detection)
+static inline void pf_observe(int pid, int page) {
+    PrefetchState *s = &pf_state[pid];
+    int d = s->last_page == -1 ? 0 : page - s->last_page;
+    s->confirmed = d != 0 && d == s->stride;
+    s->stride = d;
+    s->last_page = page;
+}
+
+// Pages to read ahead after pid faulted on page; returns how many were written to out
+static int pf_predict(int pid, int page, int num_pages, int *out) {
+    PrefetchState *s = &pf_state[pid];
+    int step = 1;
+    if (pf_mode == PF_STRIDE) {
+        if (!s->confirmed) return 0;
+        step = s->stride;
+    }
+    int n = s->window;
+    if (n == 0 && ++s->faults % PF_PROBE == 0) n = 1;
+    int k = 0;
+    for (int i = 1; i <= n; i++) {
+        long p = page + (long)i * step;
+        if (p < 0 || p >= num_pages) break;
+        out[k++] = (int)p;
+    }
+    return k;
+}
+
+// A prefetched page of pid was referenced (used = 1) or evicted unreferenced (used = 0)
+static void pf_outcome(int pid, int used) {
+    PrefetchState *s = &pf_state[pid];
+    if (used) s->useful++; else s->wasted++;
+    int total = s->useful + s->wasted;
+    if (!pf_adapt || total < PF_ADAPT_EVERY) return;
+    if (4 * s->useful >= 3 * total) {
+        s->window = s->window == 0 ? 1 : s->window * 2 > pf_max ? pf_max : s->window * 2;
+    } else if (4 * s->useful < total) {
+        s->window /= 2;
+    }
+    s->useful = s->wasted = 0;
+}
+
+#endif // PREFETCH_H
@@ -0,0 +1,271 @@
+// scheduler.h
+// CPU scheduling policies for the Scheduler. Selected at startup by name
+// (SCHED_POLICY environment variable or the Scheduler's first argument).
+//
+// SCHED_POLICY=rr|priority|mlfq  (default rr)
+// SCHED_QUANTUM=n     References a dispatch may consume before it is preempted (default
+//                     SIM_BATCH, else 1: every reference is a dispatch, the original FCFS ring).
+//                     A batched process never submits past its quantum, so a quantum
+//                     below SIM_BATCH shrinks the batches to the quantum.
+// SCHED_PRIORITY=a,b,...  Static priority per process for "priority", 0 runs first
+//                     (default: the process id; missing entries use the last one given)
+// MLFQ_LEVELS=n       Feedback levels (default 3); level l runs a quantum of SCHED_QUANTUM << l
+// MLFQ_DEMOTE=n       Faults at one level before the process drops a level (default 2)
+// MLFQ_BOOST=n        Dispatches between moving every process back to level 0 (default 64)
+// SIM_FAULT_US=n      Simulated disk time to service a page fault (default 0: the fault
+//                     completes at once and the process is simply re-queued)
+// SIM_DISKS=n         Fault reads the disk serves concurrently (default 1)
+// SIM_REF_US=n        Simulated CPU time per reference (default 1)
+// SIM_WRITEBACK_US=n  Disk time to write back a dirty page (default SIM_FAULT_US)
+// SIM_CPUS=n          Processes dispatched at once, each CPU on its own clock (default 1);
+//                     idle CPUs advance with the busy ones, I/O wakes processes as CPUs free up
+//
+// Ready processes sit in one FIFO per level and the lowest non-empty level
+// runs first. A policy sets the level a process joins (sp_level), its
+// quantum, and what to learn when a dispatch ends:
+//   quantum(pid)                   references for its next dispatch
+//   on_end(pid, used, faulted)     dispatch over: quantum expired, fault, or finished
+// A fault always ends the dispatch (the process waits for its page); a hit
+// lets the process keep the CPU until its quantum is used up. The MMU answers
+// such hits straight back to the process (a Ready_To_Run carrying the quantum
+// left), so the Scheduler only hears from a dispatch when it ends.
+//
+// Time is simulated: references advance the clock by SIM_REF_US, and with
+// SIM_FAULT_US set a fault queues a disk read and blocks the process until
+// it completes while the others keep running. The MMU has already loaded
+// the page, so only the timing is deferred, never the page-table state.
+// A fault that evicted a dirty page reads only after the write-back; write-backs
+// by the MMU's background cleaner occupy a disk but block no process. They are
+// queued when the Scheduler next hears from the MMU, at that CPU's clock.
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include "common.h"
+
+#define SCHED_MAX_LEVELS 16
+
+typedef struct {
+    const char *name;
+    int  (*quantum)(int pid);
+    void (*on_end)(int pid, int used, int faulted);
+} SchedPolicy;
+
+// --- Context shared by all policies (set by sched_select) ---
+static int sp_procs;
+static int sp_quantum;                       // Base quantum in references
+static int *sp_level;                        // Current level per process
+static long sp_demotions, sp_promotions, sp_boosts;
+
+// --- Ready queues: one circular FIFO per level, each holds every process at most once ---
+typedef struct { int *slots; int head, count; } ReadyQueue;
+
+static ReadyQueue sp_ready[SCHED_MAX_LEVELS];
+static int sp_levels;
+
+static void rq_push(int level, int pid) {
+    ReadyQueue *q = &sp_ready[level];
+    q->slots[(q->head + q->count) % sp_procs] = pid;
+    q->count++;
+}
+
+// Highest-priority ready process, -1 if none
+static int rq_pop(void) {
+    for (int l = 0; l < sp_levels; l++) {
+        ReadyQueue *q = &sp_ready[l];
+        if (q->count == 0) continue;
+        int pid = q->slots[q->head];
+        q->head = (q->head + 1) % sp_procs;
+        q->count--;
+        return pid;
+    }
+    return -1;
+}
+
+static int rq_peek(void) {
+    for (int l = 0; l < sp_levels; l++) {
+        if (sp_ready[l].count > 0) return sp_ready[l].slots[sp_ready[l].head];
+    }
+    return -1;
+}
+
+// Re-file every queued process after a level change (MLFQ boost)
+static void rq_rebuild(void) {
+    int *pids = malloc(sp_procs * sizeof(int));
+    int n = 0, pid;
+    while ((pid = rq_pop()) != -1) pids[n++] = pid;
+    for (int i = 0; i < n; i++) rq_push(sp_level[pids[i]], pids[i]);
+    free(pids);
+}
+
+// --- Round robin: one level, fixed quantum ---
+static int rr_quantum(int pid) { (void)pid; return sp_quantum; }
+static void rr_on_end(int pid, int used, int faulted) { (void)pid; (void)used; (void)faulted; }
+
+// --- Static priority: one level per priority, round robin within a level ---
+static void priority_init(void) {
+    const char *list = env_str("SCHED_PRIORITY", NULL);
+    int last = 0;
+    for (int i = 0; i < sp_procs; i++) {
+        if (list == NULL) {
+            last = i;
+        } else if (*list) {
+            last = atoi(list);
+            list += strcspn(list, ",");
+            if (*list == ',') list++;
+        }
+        sp_level[i] = last < 0 ? 0 : last >= SCHED_MAX_LEVELS ? SCHED_MAX_LEVELS - 1 : last;
+    }
+}
+
+// --- Multilevel feedback queue: fault-heavy processes sink to longer, lower-priority slices ---
+static int mlfq_demote_after;
+static int mlfq_boost_every;
+static int mlfq_dispatches;
+static int *mlfq_faults;                     // Faults at the current level
+
+static int mlfq_quantum(int pid) { return sp_quantum << sp_level[pid]; }
+
+static void mlfq_on_end(int pid, int used, int faulted) {
+    if (faulted) {
+        if (++mlfq_faults[pid] >= mlfq_demote_after && sp_level[pid] < sp_levels - 1) {
+            sp_level[pid]++;
+            mlfq_faults[pid] = 0;
+            sp_demotions++;
+        }
+    } else if (used >= mlfq_quantum(pid) && sp_level[pid] > 0) {
+        // Ran a full slice on hits alone: its working set is resident again
+        sp_level[pid]--;
+        mlfq_faults[pid] = 0;
+        sp_promotions++;
+    }
+    if (mlfq_boost_every > 0 && ++mlfq_dispatches % mlfq_boost_every == 0) {
+        for (int i = 0; i < sp_procs; i++) {
+            sp_level[i] = 0;
+            mlfq_faults[i] = 0;
+        }
+        rq_rebuild();
+        sp_boosts++;
+    }
+}
+
+// --- Simulated fault I/O: disks with a fixed service time, blocked processes in a min-heap on completion ---
+typedef struct { long done; int pid; } IoWait;
+
+static long io_latency;                      // SIM_FAULT_US
+static long io_ref_cost;                     // SIM_REF_US
+static long io_write_cost;                   // SIM_WRITEBACK_US
+static long io_writes, io_write_time;        // Write-backs queued and their disk time
+static int io_ndisks;
+static long *io_disk_free;                   // Time each disk finishes its queued reads
+static IoWait *io_heap;
+static int io_pending;
+static long io_wait_total;                   // Sum of fault-to-ready times
+
+static void io_swap(int a, int b) { IoWait t = io_heap[a]; io_heap[a] = io_heap[b]; io_heap[b] = t; }
+
+static int io_idlest_disk(void) {
+    int d = 0;
+    for (int i = 1; i < io_ndisks; i++) {
+        if (io_disk_free[i] < io_disk_free[d]) d = i;
+    }
+    return d;
+}
+
+// Queue 'writes' dirty-page write-backs then a fault read, issued at 'now';
+// returns when the read completes (the process is blocked until then)
+static long io_submit(int pid, long now, int writes) {
+    int d = io_idlest_disk();
+    long start = io_disk_free[d] > now ? io_disk_free[d] : now;
+    io_writes += writes;
+    io_write_time += writes * io_write_cost;
+    io_disk_free[d] = start + writes * io_write_cost + io_latency;
+    io_wait_total += io_disk_free[d] - now;
+    int i = io_pending++;
+    io_heap[i] = (IoWait){io_disk_free[d], pid};
+    while (i > 0 && io_heap[(i - 1) / 2].done > io_heap[i].done) {
+        io_swap(i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+    return io_disk_free[d];
+}
+
+// Queue a background write-back at 'now': it holds a disk, nobody waits for it
+static void io_write(long now) {
+    int d = io_idlest_disk();
+    io_disk_free[d] = (io_disk_free[d] > now ? io_disk_free[d] : now) + io_write_cost;
+    io_writes++;
+    io_write_time += io_write_cost;
+}
+
+// Earliest completion time, -1 if nothing is in flight
+static long io_next(void) { return io_pending ? io_heap[0].done : -1; }
+
+// Pop one process whose read completed by 'now', -1 if none
+static int io_complete(long now) {
+    if (io_pending == 0 || io_heap[0].done > now) return -1;
+    int pid = io_heap[0].pid;
+    io_heap[0] = io_heap[--io_pending];
+    for (int i = 0; ; ) {
+        int c = 2 * i + 1;
+        if (c >= io_pending) break;
+        if (c + 1 < io_pending && io_heap[c + 1].done < io_heap[c].done) c++;
+        if (io_heap[i].done <= io_heap[c].done) break;
+        io_swap(i, c);
+        i = c;
+    }
+    return pid;
+}
+
+static void io_init(int nprocs) {
+    io_latency = atol(env_str("SIM_FAULT_US", "0"));
+    io_ref_cost = atol(env_str("SIM_REF_US", "1"));
+    io_write_cost = atol(env_str("SIM_WRITEBACK_US", env_str("SIM_FAULT_US", "0")));
+    io_ndisks = atoi(env_str("SIM_DISKS", "1"));
+    if (io_latency < 0) io_latency = 0;
+    if (io_ref_cost < 0) io_ref_cost = 0;
+    if (io_write_cost < 0) io_write_cost = 0;
+    if (io_ndisks < 1) io_ndisks = 1;
+    io_disk_free = calloc(io_ndisks, sizeof(long));
+    io_heap = malloc(nprocs * sizeof(IoWait));
+}
+
+static const SchedPolicy sched_policies[] = {
+    {"rr",       rr_quantum,   rr_on_end},
+    {"priority", rr_quantum,   rr_on_end},
+    {"mlfq",     mlfq_quantum, mlfq_on_end},
+};
+
+// Returns NULL for an unknown name
+static const SchedPolicy *sched_select(const char *name, int nprocs) {
+    const SchedPolicy *p = NULL;
+    for (size_t i = 0; i < sizeof(sched_policies) / sizeof(sched_policies[0]); i++) {
+        if (strcmp(sched_policies[i].name, name) == 0) p = &sched_policies[i];
+    }
+    if (p == NULL) return NULL;
+
+    sp_procs = nprocs;
+    sp_quantum = atoi(env_str("SCHED_QUANTUM", env_str("SIM_BATCH", "1")));
+    if (sp_quantum < 1) sp_quantum = 1;
+    sp_level = calloc(nprocs, sizeof(int));
+    sp_levels = 1;
+    if (p == &sched_policies[1]) {
+        priority_init();
+        sp_levels = SCHED_MAX_LEVELS;
+    } else if (p == &sched_policies[2]) {
+        sp_levels = atoi(env_str("MLFQ_LEVELS", "3"));
+        if (sp_levels < 1) sp_levels = 1;
+        if (sp_levels > SCHED_MAX_LEVELS) sp_levels = SCHED_MAX_LEVELS;
+        mlfq_demote_after = atoi(env_str("MLFQ_DEMOTE", "2"));
+        if (mlfq_demote_after < 1) mlfq_demote_after = 1;
+        mlfq_boost_every = atoi(env_str("MLFQ_BOOST", "64"));
+        mlfq_faults = calloc(nprocs, sizeof(int));
+    }
+    for (int l = 0; l < sp_levels; l++) {
+        sp_ready[l].slots = malloc(nprocs * sizeof(int));
+        sp_ready[l].head = sp_ready[l].count = 0;
+    }
+    io_init(nprocs);
+    return p;
+}
+
+#endif // SCHEDULER_H
@@ -0,0 +1,211 @@
+// stats.h
+// Shared-memory metrics and event trace for the Master/MMU/Scheduler pipeline.
+//
+// Master creates the segment; MMU, Scheduler and Process attach and bump
+// counters with relaxed atomics, so the hot path takes no lock and never
+// touches stdout. Master prints the summary and writes the trace at cleanup.
+//
+// SIM_QUIET=1          Suppress the per-event prints (requests, faults, evictions,
+//                      context switches); summaries are still printed
+// SIM_TRACE_EVENTS=n   Event ring capacity, rounded up to a power of two
+//                      (default 65536; 0 disables recording). The ring keeps the newest n.
+// SIM_TRACE_FILE=path  Master writes the ring there at cleanup, oldest event first:
+//                      StatsTraceHeader, then 'count' StatsEvent records
+#ifndef STATS_H
+#define STATS_H
+
+#include "common.h"
+#include <stdint.h>
+#include <stdarg.h>
+
+#define SHM_STATS_KEY 6000
+#define STATS_HIST_BUCKETS 32    // Bucket b counts latencies in [2^b, 2^(b+1)) ns
+#define STATS_TRACE_MAGIC "SIMTRCE1"
+
+enum { EV_HIT, EV_FAULT, EV_EVICT, EV_DISPATCH, EV_BLOCK, EV_FINISH, EV_PREFETCH };
+
+typedef struct {
+    uint64_t ns;                 // CLOCK_MONOTONIC, comparable across modules
+    int32_t type;                // EV_*
+    int32_t pid;
+    int32_t page;                // HIT/FAULT/EVICT/PREFETCH: page; DISPATCH: slice left; BLOCK: wake time (us)
+    int32_t frame;               // HIT/FAULT/EVICT/PREFETCH: frame; DISPATCH: CPU; otherwise -1
+} StatsEvent;
+
+typedef struct {
+    char magic[8];               // STATS_TRACE_MAGIC
+    uint64_t count;              // Events that follow
+    uint64_t dropped;            // Older events the ring overwrote
+} StatsTraceHeader;
+
+typedef struct {
+    _Atomic long refs;
+    _Atomic long faults;
+    _Atomic long dispatches;
+} ProcStats;
+
+// Shared Memory Structure for the stats segment: counters, then procs[], then the event ring
+typedef struct {
+    int num_processes;
+    unsigned event_capacity;     // Power of two, or 0 when recording is off
+    // MMU
+    _Atomic long hits, faults, evictions, victim_ns;
+    _Atomic long inline_evictions;  // Evictions a fault had to run itself (no free frame)
+    _Atomic long writebacks;        // Dirty pages written back on eviction
+    _Atomic long cleaner_runs, cleaner_writebacks; // Background cleaner batches and their write-backs
+    _Atomic long prefetches, prefetch_hits, prefetch_wasted; // Pages read ahead, later referenced, evicted unused
+    _Atomic long mmu_wait_ns;    // Blocked waiting for requests
+    _Atomic long hit_hist[STATS_HIST_BUCKETS];    // Time to serve one reference
+    _Atomic long fault_hist[STATS_HIST_BUCKETS];
+    // Scheduler
+    _Atomic long dispatches, context_switches;
+    _Atomic long sched_wait_ns;  // Blocked waiting for MMU responses
+    // Processes
+    _Atomic long proc_wait_ns;   // Blocked waiting for Ready_To_Run, all processes
+    _Atomic unsigned long events; // Events ever recorded (next slot: events % capacity)
+    ProcStats procs[];
+} SimStats;
+
+#define SIM_STATS_SIZE(procs, events) \
+    (sizeof(SimStats) + (size_t)(procs) * sizeof(ProcStats) + (size_t)(events) * sizeof(StatsEvent))
+#define STATS_EVENTS(st) ((StatsEvent *)&(st)->procs[(st)->num_processes])
+
+static SimStats *sim_stats;      // This module's attachment
+static int stats_quiet;
+
+static inline long stats_now_ns(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1000000000L + t.tv_nsec;
+}
+
+static inline void stats_add(_Atomic long *counter, long n) {
+    atomic_fetch_add_explicit(counter, n, memory_order_relaxed);
+}
+
+static inline void stats_hist(_Atomic long *hist, long ns) {
+    int b = 0;
+    while (b < STATS_HIST_BUCKETS - 1 && ns >> (b + 1)) b++;
+    stats_add(&hist[b], 1);
+}
+
+static inline void stats_event(int type, int pid, int page, int frame, long ns) {
+    SimStats *st = sim_stats;
+    if (st->event_capacity == 0) return;
+    unsigned long i = atomic_fetch_add_explicit(&st->events, 1, memory_order_relaxed);
+    STATS_EVENTS(st)[i & (st->event_capacity - 1)] = (StatsEvent){(uint64_t)ns, type, pid, page, frame};
+}
+
+// Per-event console output, off in quiet mode
+static inline void event_log(const char *fmt, ...) {
+    if (stats_quiet) return;
+    va_list ap;
+    va_start(ap, fmt);
+    vprintf(fmt, ap);
+    va_end(ap);
+}
+
+// --- Setup ---
+
+// Master: create (and reset) the stats segment; returns the shm id
+static inline int stats_create(int num_processes) {
+    long want = atol(env_str("SIM_TRACE_EVENTS", "65536"));
+    unsigned capacity = 0;
+    if (want > 0) {
+        capacity = 1;
+        while (capacity < want && capacity < (1u << 24)) capacity <<= 1;
+    }
+    int id = shm_create(SHM_STATS_KEY, SIM_STATS_SIZE(num_processes, capacity));
+    if (id == -1) return -1;
+    SimStats *st = (SimStats *)shmat(id, NULL, 0);
+    if (st == (void *)-1) return -1;
+    memset(st, 0, SIM_STATS_SIZE(num_processes, capacity));
+    st->num_processes = num_processes;
+    st->event_capacity = capacity;
+    shmdt(st);
+    return id;
+}
+
+// Modules: attach to the segment and read SIM_QUIET; returns -1 on failure
+static inline int stats_attach(void) {
+    stats_quiet = atoi(env_str("SIM_QUIET", "0")) != 0;
+    int id = shmget(SHM_STATS_KEY, 0, 0666);
+    if (id == -1) return -1;
+    sim_stats = (SimStats *)shmat(id, NULL, 0);
+    return sim_stats == (void *)-1 ? -1 : 0;
+}
+
+// --- Reporting (Master) ---
+
+// Upper bound (ns) of the bucket holding quantile q, 0 if the histogram is empty
+static inline long stats_quantile(_Atomic long *hist, double q) {
+    long total = 0, seen = 0;
+    for (int b = 0; b < STATS_HIST_BUCKETS; b++) total += hist[b];
+    if (total == 0) return 0;
+    for (int b = 0; b < STATS_HIST_BUCKETS; b++) {
+        seen += hist[b];
+        if (seen >= q * total) return 2L << b;
+    }
+    return 2L << (STATS_HIST_BUCKETS - 1);
+}
+
+static inline void stats_print_hist(const char *name, _Atomic long *hist) {
+    long total = 0;
+    for (int b = 0; b < STATS_HIST_BUCKETS; b++) total += hist[b];
+    if (total == 0) return;
+    printf("Master: %s service time: p50 < %ld ns, p90 < %ld ns, p99 < %ld ns\n", name,
+           stats_quantile(hist, 0.5), stats_quantile(hist, 0.9), stats_quantile(hist, 0.99));
+    for (int b = 0; b < STATS_HIST_BUCKETS; b++) {
+        if (hist[b] == 0) continue;
+        printf("Master:   [%9ld, %9ld) ns %8ld  %5.1f%%\n", 1L << b, 2L << b, (long)hist[b], 100.0 * hist[b] / total);
+    }
+}
+
+static inline void stats_report(SimStats *st) {
+    long refs = st->hits + st->faults;
+    printf("Master: summary: %ld references, %ld hits, %ld faults (%.1f%%), %ld evictions, "
+           "%ld dispatches, %ld context switches\n",
+           refs, (long)st->hits, (long)st->faults, refs ? 100.0 * st->faults / refs : 0.0,
+           (long)st->evictions, (long)st->dispatches, (long)st->context_switches);
+    printf("Master: IPC wait: MMU %.1f ms, Scheduler %.1f ms, Processes %.1f ms (all processes)\n",
+           st->mmu_wait_ns / 1e6, st->sched_wait_ns / 1e6, st->proc_wait_ns / 1e6);
+    for (int p = 0; p < st->num_processes; p++) {
+        ProcStats *ps = &st->procs[p];
+        printf("Master:   P%d: %ld references, %ld faults (%.1f%% fault rate), %ld dispatches\n", p,
+               (long)ps->refs, (long)ps->faults, ps->refs ? 100.0 * ps->faults / ps->refs : 0.0,
+               (long)ps->dispatches);
+    }
+    if (st->writebacks || st->cleaner_runs) {
+        printf("Master: write-back: %ld dirty evictions, %ld during a fault; cleaner: %ld batches, "
+               "%ld of %ld evictions ahead of demand; %.1f%% of faults found a free frame\n",
+               (long)st->writebacks, (long)(st->writebacks - st->cleaner_writebacks), (long)st->cleaner_runs,
+               (long)(st->evictions - st->inline_evictions), (long)st->evictions,
+               st->faults ? 100.0 * (st->faults - st->inline_evictions) / st->faults : 0.0);
+    }
+    if (st->prefetches) {
+        printf("Master: prefetch: %ld pages read ahead, %ld referenced (%.1f%% accuracy), %ld evicted unused\n",
+               (long)st->prefetches, (long)st->prefetch_hits, 100.0 * st->prefetch_hits / st->prefetches,
+               (long)st->prefetch_wasted);
+    }
+    stats_print_hist("hit", st->hit_hist);
+    stats_print_hist("fault", st->fault_hist);
+}
+
+// Write the ring, oldest event first; returns -1 on failure
+static inline int stats_write_trace(SimStats *st, const char *path) {
+    FILE *f = fopen(path, "wb");
+    if (f == NULL) { perror(path); return -1; }
+    unsigned long total = st->events, cap = st->event_capacity;
+    unsigned long kept = total < cap ? total : cap;
+    StatsTraceHeader h;
+    memcpy(h.magic, STATS_TRACE_MAGIC, 8);
+    h.count = kept;
+    h.dropped = total - kept;
+    fwrite(&h, sizeof(h), 1, f);
+    for (unsigned long i = total - kept; i < total; i++) {
+        fwrite(&STATS_EVENTS(st)[i & (cap - 1)], sizeof(StatsEvent), 1, f);
+    }
+    return fclose(f) == 0 ? 0 : -1;
+}
+
+#endif // STATS_H
@@ -0,0 +1,138 @@
+// tlb.h
+// Simulated TLB consulted by the MMU before the page table.
+//
+// TLB_ENTRIES=n       Total entries (default 64, 0 disables the TLB)
+// TLB_WAYS=n          Associativity (default 4; TLB_WAYS=TLB_ENTRIES is fully associative)
+// TLB_MODE=asid|flush Tag entries with the process id, or flush whenever the
+//                     MMU serves a different process than last time (default asid)
+// TLB_REPLACE=lru|random  Victim within a set (default lru)
+//
+// An entry caches the frame and a pointer to the PTE, so a hit skips the
+// radix walk and only touches the PTE itself to set the accessed state.
+//
+// Every MMU worker thread has its own TLB, like one per CPU. A shootdown only
+// reaches the evicting thread's TLB (the background cleaner's is always empty),
+// so a lookup also checks the cached frame against the PTE (the caller holds
+// its stripe): an entry whose page was evicted or moved is dropped there, counted
+// as a shootdown, and the lookup is a miss, never a hit.
+#ifndef TLB_H
+#define TLB_H
+
+#include "common.h"
+
+typedef struct {
+    int valid;
+    int asid;                  // Owning process
+    int page;
+    int frame;
+    PTE *pte;
+    unsigned long stamp;       // Last use, for LRU within the set
+} TLBEntry;
+
+static _Thread_local TLBEntry *tlb;
+static _Thread_local int tlb_sets, tlb_ways;
+static _Thread_local int tlb_flush_on_switch, tlb_random;
+static _Thread_local int tlb_current_asid = -1;
+static _Thread_local unsigned long tlb_clock;
+static _Thread_local unsigned int tlb_seed = 1;
+static _Thread_local long tlb_hits, tlb_misses, tlb_flushes, tlb_shootdowns;
+static long tlb_total[4];                    // Counters of every thread after tlb_fold
+
+static void tlb_init(void) {
+    int entries = atoi(env_str("TLB_ENTRIES", "64"));
+    tlb_ways = atoi(env_str("TLB_WAYS", "4"));
+    tlb_flush_on_switch = strcmp(env_str("TLB_MODE", "asid"), "flush") == 0;
+    tlb_random = strcmp(env_str("TLB_REPLACE", "lru"), "random") == 0;
+    if (entries <= 0) { tlb_sets = 0; return; }
+    if (tlb_ways <= 0 || tlb_ways > entries) tlb_ways = entries;
+    tlb_sets = entries / tlb_ways;
+    tlb = calloc((size_t)tlb_sets * tlb_ways, sizeof(TLBEntry));
+}
+
+static TLBEntry *tlb_set(int pid, int page) {
+    unsigned h = (unsigned)page * 2654435761u ^ (tlb_flush_on_switch ? 0u : (unsigned)pid * 40503u);
+    return &tlb[(size_t)(h % tlb_sets) * tlb_ways];
+}
+
+static void tlb_flush(void) {
+    for (int i = 0; i < tlb_sets * tlb_ways; i++) tlb[i].valid = 0;
+    tlb_flushes++;
+}
+
+// Translation for (pid, page), or NULL on a miss
+static TLBEntry *tlb_lookup(int pid, int page) {
+    if (tlb_sets == 0) return NULL;
+    if (tlb_flush_on_switch && pid != tlb_current_asid) {
+        if (tlb_current_asid != -1) tlb_flush();
+        tlb_current_asid = pid;
+    }
+    TLBEntry *set = tlb_set(pid, page);
+    for (int w = 0; w < tlb_ways; w++) {
+        if (set[w].valid && set[w].page == page && set[w].asid == pid) {
+            if (!set[w].pte->present || (int)set[w].pte->frame_number != set[w].frame) {
+                set[w].valid = 0;   // Evicted by another thread: a late shootdown
+                tlb_shootdowns++;
+                break;
+            }
+            set[w].stamp = ++tlb_clock;
+            tlb_hits++;
+            return &set[w];
+        }
+    }
+    tlb_misses++;
+    return NULL;
+}
+
+static void tlb_insert(int pid, int page, int frame, PTE *pte) {
+    if (tlb_sets == 0) return;
+    TLBEntry *set = tlb_set(pid, page);
+    TLBEntry *slot = NULL;
+    // Reuse the page's own entry if it has one, so a page never sits in two ways
+    for (int w = 0; w < tlb_ways && slot == NULL; w++) {
+        if (set[w].valid && set[w].page == page && set[w].asid == pid) slot = &set[w];
+    }
+    for (int w = 0; w < tlb_ways && slot == NULL; w++) {
+        if (!set[w].valid) slot = &set[w];
+    }
+    if (slot == NULL && tlb_random) slot = &set[rand_r(&tlb_seed) % tlb_ways];
+    if (slot == NULL) {
+        slot = &set[0];
+        for (int w = 1; w < tlb_ways; w++) {
+            if (set[w].stamp < slot->stamp) slot = &set[w];
+        }
+    }
+    *slot = (TLBEntry){1, pid, page, frame, pte, ++tlb_clock};
+}
+
+// Shootdown: the page lost its frame
+static void tlb_invalidate(int pid, int page) {
+    if (tlb_sets == 0) return;
+    TLBEntry *set = tlb_set(pid, page);
+    for (int w = 0; w < tlb_ways; w++) {
+        if (set[w].valid && set[w].page == page && set[w].asid == pid) {
+            set[w].valid = 0;
+            tlb_shootdowns++;
+        }
+    }
+}
+
+// Add this thread's counters to the totals tlb_report prints
+static void tlb_fold(void) {
+    long *c[4] = {&tlb_hits, &tlb_misses, &tlb_flushes, &tlb_shootdowns};
+    for (int i = 0; i < 4; i++) {
+        __atomic_fetch_add(&tlb_total[i], *c[i], __ATOMIC_RELAXED);
+        *c[i] = 0;
+    }
+}
+
+static void tlb_report(void) {
+    if (tlb_sets == 0) { printf("MMU: TLB disabled\n"); return; }
+    tlb_fold();
+    long lookups = tlb_total[0] + tlb_total[1];
+    printf("MMU: TLB %d x %d-way (%s, %s): %ld hits, %ld misses (%.1f%% hit rate), %ld flushes, %ld shootdowns\n",
+           tlb_sets, tlb_ways, tlb_flush_on_switch ? "flush on switch" : "ASID tagged",
+           tlb_random ? "random" : "LRU", tlb_total[0], tlb_total[1],
+           lookups ? 100.0 * tlb_total[0] / lookups : 0.0, tlb_total[2], tlb_total[3]);
+}
+
+#endif // TLB_H
@@ -0,0 +1,158 @@
+// trace.h
+// Page-reference traces for the offline simulators, memory-mapped so a
+// replay streams straight from the page cache.
+//
+// Text:   page numbers separated by whitespace or commas; '#' starts a
+//         comment that runs to the end of the line.
+// Binary: TraceHeader followed by 'count' little-endian uint32 page numbers.
+//         PageReplace -t trace.txt -c trace.bin converts a text trace.
+//
+// An in-memory reference string (e.g. the random one) is wrapped with
+// trace_from_array so every simulator consumes one TraceCursor interface.
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define TRACE_MAGIC "PGTRACE1"
+
+typedef struct {
+    char magic[8];             // TRACE_MAGIC
+    uint64_t count;            // References that follow
+    uint64_t max_page;         // Largest page number in the trace
+} TraceHeader;
+
+typedef struct {
+    const char *map;           // Whole file mapping (NULL for an in-memory array)
+    size_t map_size;
+    const char *text;          // Text trace: the characters to parse
+    const uint32_t *refs;      // Binary trace or in-memory array
+    long count;                // References in the trace
+    unsigned long max_page;
+} Trace;
+
+typedef struct {
+    const Trace *t;
+    size_t pos;                // Character offset (text) or reference index
+} TraceCursor;
+
+static inline TraceCursor trace_cursor(const Trace *t) {
+    return (TraceCursor){t, 0};
+}
+
+// Next page number; 0 at the end of the trace
+static inline int trace_next(TraceCursor *c, unsigned long *page) {
+    const Trace *t = c->t;
+    if (t->refs) {
+        if ((long)c->pos >= t->count) return 0;
+        *page = t->refs[c->pos++];
+        return 1;
+    }
+    const char *s = t->text, *end = t->map + t->map_size;
+    const char *p = s + c->pos;
+    for (;;) {
+        while (p < end && (*p < '0' || *p > '9')) {
+            if (*p == '#') {
+                while (p < end && *p != '\n') p++;
+            } else {
+                p++;
+            }
+        }
+        if (p == end) { c->pos = p - s; return 0; }
+        unsigned long v = 0;
+        while (p < end && *p >= '0' && *p <= '9') v = v * 10 + (unsigned long)(*p++ - '0');
+        c->pos = p - s;
+        *page = v;
+        return 1;
+    }
+}
+
+static inline void trace_from_array(Trace *t, const uint32_t *refs, long count) {
+    memset(t, 0, sizeof(*t));
+    t->refs = refs;
+    t->count = count;
+    for (long i = 0; i < count; i++) {
+        if (refs[i] > t->max_page) t->max_page = refs[i];
+    }
+}
+
+static inline void trace_close(Trace *t) {
+    if (t->map) munmap((void *)t->map, t->map_size);
+    t->map = NULL;
+}
+
+// Map a trace file, detecting the format; returns -1 (with a message) on failure
+static inline int trace_open(Trace *t, const char *path) {
+    memset(t, 0, sizeof(*t));
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) { perror(path); return -1; }
+    struct stat st;
+    if (fstat(fd, &st) == -1 || st.st_size == 0) {
+        fprintf(stderr, "%s: empty or unreadable trace\n", path);
+        close(fd);
+        return -1;
+    }
+    t->map_size = st.st_size;
+    t->map = mmap(NULL, t->map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (t->map == MAP_FAILED) { perror("mmap trace"); t->map = NULL; return -1; }
+    madvise((void *)t->map, t->map_size, MADV_SEQUENTIAL);
+
+    const TraceHeader *h = (const TraceHeader *)t->map;
+    if (t->map_size >= sizeof(TraceHeader) && memcmp(h->magic, TRACE_MAGIC, 8) == 0) {
+        if (sizeof(TraceHeader) + h->count * sizeof(uint32_t) > t->map_size) {
+            fprintf(stderr, "%s: truncated binary trace\n", path);
+            trace_close(t);
+            return -1;
+        }
+        t->refs = (const uint32_t *)(t->map + sizeof(TraceHeader));
+        t->count = (long)h->count;
+        t->max_page = h->max_page;
+        return 0;
+    }
+
+    // Text: one counting pass for the length and the page range
+    t->text = t->map;
+    TraceCursor c = trace_cursor(t);
+    unsigned long page;
+    while (trace_next(&c, &page)) {
+        t->count++;
+        if (page > t->max_page) t->max_page = page;
+    }
+    if (t->max_page > UINT32_MAX) {
+        fprintf(stderr, "%s: page numbers must fit in 32 bits\n", path);
+        trace_close(t);
+        return -1;
+    }
+    return 0;
+}
+
+// Write any trace in the binary format; returns -1 on failure
+static inline int trace_write_binary(const Trace *t, const char *path) {
+    FILE *f = fopen(path, "wb");
+    if (f == NULL) { perror(path); return -1; }
+    TraceHeader h;
+    memcpy(h.magic, TRACE_MAGIC, 8);
+    h.count = (uint64_t)t->count;
+    h.max_page = t->max_page;
+    fwrite(&h, sizeof(h), 1, f);
+    uint32_t buf[4096];
+    int n = 0;
+    TraceCursor c = trace_cursor(t);
+    unsigned long page;
+    while (trace_next(&c, &page)) {
+        buf[n++] = (uint32_t)page;
+        if (n == 4096) { fwrite(buf, sizeof(uint32_t), n, f); n = 0; }
+    }
+    fwrite(buf, sizeof(uint32_t), n, f);
+    return fclose(f) == 0 ? 0 : -1;
+}
+
+#endif // TRACE_H
@@ -0,0 +1,205 @@
+// transport.h
+// Message transport between Process, MMU and Scheduler.
+//
+// SIM_TRANSPORT=msgq  SysV message queue keyed by MSG_QUEUE_KEY (default)
+// SIM_TRANSPORT=ring  Lock-free single-producer/single-consumer rings in shared
+//                     memory, one per channel, futex blocking when empty:
+//                       Process -> MMU        requests[pid]   (MMU waits on mmu_bell;
+//                                             MMU worker w of n pops the rings pid % n == w)
+//                       MMU -> Scheduler      responses
+//                       Scheduler -> Process  commands[pid]
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include "common.h"
+#include <stdatomic.h>
+#include <sched.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+
+#define SHM_RINGS_KEY 7000
+#define RING_SLOTS 64 // Power of two; the lockstep protocol keeps at most a few in flight
+
+typedef struct {
+    _Atomic unsigned head;     // Next slot to read, written by the consumer only
+    _Atomic unsigned tail;     // Next slot to write, written by the producer only (futex word)
+    _Atomic int waiting;       // Consumer is (about to be) asleep on tail
+    Message slots[RING_SLOTS];
+} Ring;
+
+// Shared Memory Structure for the ring transport.
+// rings[] holds the responses ring, then num_processes request rings,
+// then num_processes command rings.
+typedef struct {
+    int num_processes;
+    _Atomic unsigned mmu_bell; // Bumped after every request push (futex word)
+    _Atomic int mmu_waiting;   // MMU workers (about to be) asleep on mmu_bell
+    Ring rings[];
+} RingSet;
+
+#define RING_SET_SIZE(procs) (sizeof(RingSet) + (size_t)(2 * (procs) + 1) * sizeof(Ring))
+#define RING_RESPONSES(rs)     (&(rs)->rings[0])
+#define RING_REQUESTS(rs, pid) (&(rs)->rings[1 + (pid)])
+#define RING_COMMANDS(rs, pid) (&(rs)->rings[1 + (rs)->num_processes + (pid)])
+
+typedef struct {
+    int use_rings;
+    int msg_id;
+    RingSet *rings;
+    int next_request_ring;     // MMU: round-robin scan position
+    int first_request_ring;    // MMU worker: the request rings it serves,
+    int request_ring_stride;   // first, first + stride, ... (default 0, 1: all)
+} Transport;
+
+static inline void futex_wait(_Atomic unsigned *addr, unsigned val) {
+    syscall(SYS_futex, (unsigned *)addr, FUTEX_WAIT, val, NULL, NULL, 0);
+}
+
+static inline void futex_wake(_Atomic unsigned *addr) {
+    syscall(SYS_futex, (unsigned *)addr, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+static inline void ring_init(Ring *r) {
+    atomic_store(&r->head, 0);
+    atomic_store(&r->tail, 0);
+    atomic_store(&r->waiting, 0);
+}
+
+static inline void ring_push(Ring *r, const Message *m) {
+    unsigned t = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    while (t - atomic_load_explicit(&r->head, memory_order_acquire) == RING_SLOTS) {
+        sched_yield(); // Full: only possible if the consumer died
+    }
+    memcpy(&r->slots[t & (RING_SLOTS - 1)], m, sizeof(long) + MSG_PAYLOAD(m));
+    atomic_store(&r->tail, t + 1); // seq_cst: ordered against the waiting check below
+    if (atomic_load(&r->waiting)) futex_wake(&r->tail);
+}
+
+// Non-blocking pop, returns 0 if the ring is empty
+static inline int ring_try_pop(Ring *r, Message *m) {
+    unsigned h = atomic_load_explicit(&r->head, memory_order_relaxed);
+    if (atomic_load_explicit(&r->tail, memory_order_acquire) == h) return 0;
+    const Message *slot = &r->slots[h & (RING_SLOTS - 1)];
+    memcpy(m, slot, sizeof(long) + MSG_PAYLOAD(slot));
+    atomic_store_explicit(&r->head, h + 1, memory_order_release);
+    return 1;
+}
+
+static inline void ring_pop(Ring *r, Message *m) {
+    for (int spins = 0; !ring_try_pop(r, m); spins++) {
+        if (spins < 128) continue;
+        unsigned h = atomic_load_explicit(&r->head, memory_order_relaxed);
+        atomic_store(&r->waiting, 1);
+        if (atomic_load(&r->tail) == h) futex_wait(&r->tail, h);
+        atomic_store(&r->waiting, 0);
+    }
+}
+
+// --- Setup ---
+
+// Master: create (and reset) the ring segment; returns the shm id
+static inline int transport_create(int num_processes) {
+    int id = shm_create(SHM_RINGS_KEY, RING_SET_SIZE(num_processes));
+    if (id == -1) return -1;
+    RingSet *rs = (RingSet *)shmat(id, NULL, 0);
+    if (rs == (void *)-1) return -1;
+    rs->num_processes = num_processes;
+    for (int i = 0; i < 2 * num_processes + 1; i++) ring_init(&rs->rings[i]);
+    atomic_store(&rs->mmu_bell, 0);
+    atomic_store(&rs->mmu_waiting, 0);
+    shmdt(rs);
+    return id;
+}
+
+// Modules: attach to the transport chosen by SIM_TRANSPORT; returns -1 on failure
+static inline int transport_attach(Transport *t) {
+    memset(t, 0, sizeof(*t));
+    t->request_ring_stride = 1;
+    t->use_rings = strcmp(env_str("SIM_TRANSPORT", "msgq"), "ring") == 0;
+    t->msg_id = msgget(MSG_QUEUE_KEY, 0666);
+    if (t->msg_id == -1) return -1;
+    if (t->use_rings) {
+        int id = shmget(SHM_RINGS_KEY, 0, 0666);
+        if (id == -1) return -1;
+        t->rings = (RingSet *)shmat(id, NULL, 0);
+        if (t->rings == (void *)-1) return -1;
+    }
+    return 0;
+}
+
+static inline void transport_detach(Transport *t) {
+    if (t->use_rings) shmdt(t->rings);
+}
+
+// --- Channels (all return -1 once the message queue is gone) ---
+
+// Process -> MMU
+static inline int send_request(Transport *t, Message *m) {
+    m->mtype = MT_PROCESS_REQUEST;
+    if (!t->use_rings) return msgsnd(t->msg_id, m, MSG_PAYLOAD(m), 0);
+    RingSet *rs = t->rings;
+    ring_push(RING_REQUESTS(rs, m->sender_pid), m);
+    atomic_fetch_add(&rs->mmu_bell, 1);
+    if (atomic_load(&rs->mmu_waiting)) futex_wake(&rs->mmu_bell);
+    return 0;
+}
+
+// MMU: next request from any process this Transport serves
+static inline int recv_request(Transport *t, Message *m) {
+    if (!t->use_rings) {
+        return msgrcv(t->msg_id, m, sizeof(Message) - sizeof(long), MT_PROCESS_REQUEST, 0) == -1 ? -1 : 0;
+    }
+    RingSet *rs = t->rings;
+    int stride = t->request_ring_stride;
+    int served = (rs->num_processes - t->first_request_ring + stride - 1) / stride;
+    if (served <= 0) return -1;
+    for (int spins = 0; ; spins++) {
+        unsigned bell = atomic_load(&rs->mmu_bell);
+        for (int i = 0; i < served; i++) {
+            int k = (t->next_request_ring + i) % served;
+            if (ring_try_pop(RING_REQUESTS(rs, t->first_request_ring + k * stride), m)) {
+                t->next_request_ring = (k + 1) % served;
+                return 0;
+            }
+        }
+        if (spins < 128) continue;
+        atomic_fetch_add(&rs->mmu_waiting, 1);
+        if (atomic_load(&rs->mmu_bell) == bell) futex_wait(&rs->mmu_bell, bell);
+        atomic_fetch_sub(&rs->mmu_waiting, 1);
+    }
+}
+
+// MMU -> Scheduler
+static inline int send_response(Transport *t, Message *m) {
+    m->mtype = MT_MMU_RESPONSE;
+    if (!t->use_rings) return msgsnd(t->msg_id, m, MSG_PAYLOAD(m), 0);
+    ring_push(RING_RESPONSES(t->rings), m);
+    return 0;
+}
+
+static inline int recv_response(Transport *t, Message *m) {
+    if (!t->use_rings) {
+        return msgrcv(t->msg_id, m, sizeof(Message) - sizeof(long), MT_MMU_RESPONSE, 0) == -1 ? -1 : 0;
+    }
+    ring_pop(RING_RESPONSES(t->rings), m);
+    return 0;
+}
+
+// Scheduler -> Process (m->sender_pid is the target, addressed by its own mtype)
+static inline int send_command(Transport *t, Message *m) {
+    m->mtype = MT_SCHEDULER_CMD_FOR(m->sender_pid);
+    if (!t->use_rings) return msgsnd(t->msg_id, m, MSG_PAYLOAD(m), 0);
+    ring_push(RING_COMMANDS(t->rings, m->sender_pid), m);
+    return 0;
+}
+
+static inline int recv_command(Transport *t, int pid, Message *m) {
+    if (!t->use_rings) {
+        return msgrcv(t->msg_id, m, sizeof(Message) - sizeof(long), MT_SCHEDULER_CMD_FOR(pid), 0) == -1 ? -1 : 0;
+    }
+    ring_pop(RING_COMMANDS(t->rings, pid), m);
+    return 0;
+}
+
+#endif // TRANSPORT_H
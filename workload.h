@@ -0,0 +1,192 @@
+// workload.h
+// Seeded page-reference generators shared by Process, PageReplace and the
+// benchmarks. A reference string is fully determined by (spec, pages, seed),
+// so any run can be regenerated exactly.
+//
+// Workload specs:
+//   uniform             every page equally likely (no locality)
+//   zipf[:s]            page k drawn with probability proportional to (k+1)^-s
+//                       (default s 0.99); low page numbers are the hot ones
+//   ws[:size[,phase]]   uniform within a window of 'size' pages that moves to a random
+//                       place every 'phase' references (default pages/8 and 1000)
+//   scan                0, 1, ..., pages-1, then around again
+//   loop[:len]          0 .. len-1 repeated (default pages); LRU faults on every
+//                       reference once len exceeds the frame count
+//   trace:path          replay a text or binary trace (trace.h), page numbers mod pages
+//
+// workload_seek() sets the position of the positional kinds (scan, loop, ws
+// phases, trace), so several processes can replay different parts of one trace.
+#ifndef WORKLOAD_H
+#define WORKLOAD_H
+
+#include <math.h>
+#include "trace.h"
+
+// --- xoshiro256** seeded through splitmix64 ---
+typedef struct { uint64_t s[4]; } Rng;
+
+static inline uint64_t rng_splitmix(uint64_t *x) {
+    uint64_t z = (*x += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+// Independent streams for one seed, e.g. one per process
+static inline void rng_seed(Rng *r, uint64_t seed, uint64_t stream) {
+    uint64_t x = seed ^ rng_splitmix(&stream);
+    for (int i = 0; i < 4; i++) r->s[i] = rng_splitmix(&x);
+}
+
+static inline uint64_t rng_rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+static inline uint64_t rng_next(Rng *r) {
+    uint64_t *s = r->s;
+    uint64_t out = rng_rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0]; s[3] ^= s[1]; s[1] ^= s[2]; s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rng_rotl(s[3], 45);
+    return out;
+}
+
+// Uniform in [0, n)
+static inline uint64_t rng_below(Rng *r, uint64_t n) {
+    return (uint64_t)(((unsigned __int128)rng_next(r) * n) >> 64);
+}
+
+// Uniform in [0, 1)
+static inline double rng_double(Rng *r) { return (rng_next(r) >> 11) * 0x1.0p-53; }
+
+// --- Workloads ---
+enum { WL_UNIFORM, WL_ZIPF, WL_WS, WL_SCAN, WL_LOOP, WL_TRACE };
+
+typedef struct {
+    int kind;
+    unsigned long pages;
+    unsigned long pos;               // References generated so far
+    double s, h_x1, h_n, sc;         // Zipf: exponent and rejection-inversion constants
+    unsigned long size, phase;       // ws: window and phase length; loop: length in size
+    unsigned long base;              // ws: current window start
+    Trace trace;
+    TraceCursor cursor;
+} Workload;
+
+// Zipf by rejection-inversion (Hoermann and Derflinger): O(1) per sample, no table
+static inline double zipf_log1p_over(double x) { return fabs(x) > 1e-8 ? log1p(x) / x : 1 - x / 2; }
+static inline double zipf_expm1_over(double x) { return fabs(x) > 1e-8 ? expm1(x) / x : 1 + x / 2; }
+static inline double zipf_h(double s, double x) { return exp(-s * log(x)); }
+static inline double zipf_hint(double s, double x) {
+    double lx = log(x);
+    return zipf_expm1_over((1 - s) * lx) * lx;
+}
+static inline double zipf_hint_inv(double s, double x) {
+    double t = x * (1 - s);
+    if (t < -1) t = -1;
+    return exp(zipf_log1p_over(t) * x);
+}
+
+static inline unsigned long zipf_next(Workload *w, Rng *r) {
+    for (;;) {
+        double u = w->h_n + rng_double(r) * (w->h_x1 - w->h_n);
+        double x = zipf_hint_inv(w->s, u);
+        double k = floor(x + 0.5);
+        if (k < 1) k = 1;
+        if (k > w->pages) k = w->pages;
+        if (k - x <= w->sc || u >= zipf_hint(w->s, k + 0.5) - zipf_h(w->s, k)) return (unsigned long)k - 1;
+    }
+}
+
+// Parse 'spec' for pages 0..pages-1; returns -1 (with a message) on failure
+static inline int workload_open(Workload *w, const char *spec, unsigned long pages) {
+    memset(w, 0, sizeof(*w));
+    w->pages = pages ? pages : 1;
+    const char *arg = strchr(spec, ':');
+    size_t name_len = arg ? (size_t)(arg - spec) : strlen(spec);
+    if (arg) arg++;
+    if (name_len == 7 && strncmp(spec, "uniform", 7) == 0) {
+        w->kind = WL_UNIFORM;
+    } else if (name_len == 4 && strncmp(spec, "zipf", 4) == 0) {
+        w->kind = WL_ZIPF;
+        w->s = arg ? atof(arg) : 0.99;
+        if (w->s <= 0) { fprintf(stderr, "%s: Zipf exponent must be positive\n", spec); return -1; }
+        w->h_x1 = zipf_hint(w->s, 1.5) - 1;
+        w->h_n = zipf_hint(w->s, w->pages + 0.5);
+        w->sc = 2 - zipf_hint_inv(w->s, zipf_hint(w->s, 2.5) - zipf_h(w->s, 2));
+    } else if (name_len == 2 && strncmp(spec, "ws", 2) == 0) {
+        w->kind = WL_WS;
+        w->size = w->pages / 8;
+        w->phase = 1000;
+        if (arg) sscanf(arg, "%lu,%lu", &w->size, &w->phase);
+        if (w->size < 1) w->size = 1;
+        if (w->size > w->pages) w->size = w->pages;
+        if (w->phase < 1) w->phase = 1;
+    } else if (name_len == 4 && strncmp(spec, "scan", 4) == 0) {
+        w->kind = WL_SCAN;
+    } else if (name_len == 4 && strncmp(spec, "loop", 4) == 0) {
+        w->kind = WL_LOOP;
+        w->size = arg ? strtoul(arg, NULL, 10) : w->pages;
+        if (w->size < 1) w->size = 1;
+        if (w->size > w->pages) w->size = w->pages;
+    } else if (name_len == 5 && strncmp(spec, "trace", 5) == 0 && arg) {
+        w->kind = WL_TRACE;
+        if (trace_open(&w->trace, arg) == -1) return -1;
+        if (w->trace.count == 0) {
+            fprintf(stderr, "%s: trace has no references\n", arg);
+            trace_close(&w->trace);
+            return -1;
+        }
+        w->cursor = trace_cursor(&w->trace);
+    } else {
+        fprintf(stderr, "Unknown workload '%s' (uniform, zipf[:s], ws[:size[,phase]], scan, loop[:len], trace:path)\n",
+                spec);
+        return -1;
+    }
+    return 0;
+}
+
+static inline void workload_seek(Workload *w, unsigned long pos) {
+    w->pos = pos;
+    if (w->kind != WL_TRACE) return;
+    pos %= (unsigned long)w->trace.count;
+    w->cursor = trace_cursor(&w->trace);
+    if (w->trace.refs) {
+        w->cursor.pos = pos;
+    } else {
+        unsigned long page;
+        while (pos-- > 0) trace_next(&w->cursor, &page);
+    }
+}
+
+static inline uint32_t workload_next(Workload *w, Rng *r) {
+    unsigned long page = 0;
+    switch (w->kind) {
+    case WL_UNIFORM: page = rng_below(r, w->pages); break;
+    case WL_ZIPF:    page = zipf_next(w, r); break;
+    case WL_WS:
+        if (w->pos % w->phase == 0) w->base = rng_below(r, w->pages);
+        page = (w->base + rng_below(r, w->size)) % w->pages;
+        break;
+    case WL_SCAN:    page = w->pos % w->pages; break;
+    case WL_LOOP:    page = w->pos % w->size; break;
+    case WL_TRACE:
+        if (!trace_next(&w->cursor, &page)) {
+            w->cursor = trace_cursor(&w->trace);
+            trace_next(&w->cursor, &page);
+        }
+        page %= w->pages;
+        break;
+    }
+    w->pos++;
+    return (uint32_t)page;
+}
+
+static inline void workload_fill(Workload *w, Rng *r, uint32_t *out, long n) {
+    for (long i = 0; i < n; i++) out[i] = workload_next(w, r);
+}
+
+static inline void workload_close(Workload *w) {
+    if (w->kind == WL_TRACE) trace_close(&w->trace);
+}
+
+#endif // WORKLOAD_H